@@ -26,18 +26,21 @@
 * Contact information:
 * miro@quantum-leaps.com
 */
+#include <assert.h>
 #include "hsm.h"
 
 static Msg const startMsg = { START_EVT };
 static Msg const entryMsg = { ENTRY_EVT };
 static Msg const exitMsg  = { EXIT_EVT };
-#define MAX_STATE_NESTING 8
 
-/* State Ctor...............................................................*/
+/* State Ctor (the superstate must be constructed first)...................*/
 void StateCtor(State *me, char const *name, State *super, EvtHndlr hndlr) {
     me->name  = name;
     me->super = super;
     me->hndlr = hndlr;
+    assert(super == 0 || super->depth < 255);   /* depth fits unsigned char */
+    me->depth = (unsigned char)(super ? super->depth + 1 : 0);
+    me->sub = 0;
 }
 
 /* Hsm Ctor.................................................................*/
@@ -46,22 +49,26 @@ void HsmCtor(Hsm *me, char const *name, EvtHndlr topHndlr) {
     me->name = name;
 }
 
+/* enter the states below curr down to next, outermost first................*/
+/* The path is linked through State.sub, so it is not limited in length.    */
+static void HsmEnterPath_(Hsm *me) {
+    register State *s;
+    for (s = me->next; s != me->curr; s = s->super) {
+        s->super->sub = s;                          /* trace path to target */
+    }
+    for (s = me->curr; s != me->next; ) {              /* retrace the entry */
+        s = s->sub;
+        StateOnEvent(s, me, &entryMsg);
+    }
+}
+
 /* enter and start the top state............................................*/
 void HsmOnStart(Hsm *me) {
     me->curr = &me->top;
     me->next = 0;
     StateOnEvent(me->curr, me, &entryMsg);
     while (StateOnEvent(me->curr, me, &startMsg), me->next) {
-        State *entryPath[MAX_STATE_NESTING];
-        register State **trace = entryPath;
-        register State *s;
-        *trace = 0;
-        for (s = me->next; s != me->curr; s = s->super) {
-            *(++trace) = s;                         /* trace path to target */
-        }
-        while ((s = *trace--)) {               /* retrace entry from source */
-            StateOnEvent(s, me, &entryMsg);
-        }
+        HsmEnterPath_(me);
         me->curr = me->next;
         me->next = 0;
     }
@@ -69,33 +76,17 @@ void HsmOnStart(Hsm *me) {
 
 /* state machine "engine"...................................................*/
 void HsmOnEvent(Hsm *me, Msg const *msg) {
-    State *entryPath[MAX_STATE_NESTING];
-    register State **trace;
     register State *s;
     for (s = me->curr; s; s = s->super) {
         me->source = s;                 /* level of outermost event handler */
         msg = StateOnEvent(s, me, msg);
         if (msg == 0) {
             if (me->next) {                      /* state transition taken? */
-                trace = entryPath;
-                *trace = 0;
-                for (s = me->next; s != me->curr; s = s->super) {
-                    *(++trace) = s;                 /* trace path to target */
-                }
-                while ((s = *trace--)) {          /* retrace entry from LCA */
-                    StateOnEvent(s, me, &entryMsg);
-                }
+                HsmEnterPath_(me);                       /* enter from LCA */
                 me->curr = me->next;
                 me->next = 0;
                 while (StateOnEvent(me->curr, me, &startMsg), me->next) {
-                    trace = entryPath;
-                    *trace = 0;
-                    for (s = me->next; s != me->curr; s = s->super) {
-                        *(++trace) = s;            /* record path to target */
-                    }
-                    while ((s = *trace--)) {           /* retrace the entry */
-                        StateOnEvent(s, me, &entryMsg);
-                    }
+                    HsmEnterPath_(me);
                     me->curr = me->next;
                     me->next = 0;
                 }
@@ -122,15 +113,30 @@ void HsmExit_(Hsm *me, unsigned char toLca) {
 /* find # of levels to Least Common Ancestor................................*/
 unsigned char HsmToLCA_(Hsm *me, State *target) {
     unsigned char toLca = 0;
-    if (me->source == target) {
+    register State *s = me->source;
+    register State *t = target;
+    if (s == t) {
         return 1;
     }
-    for (State *s = me->source; s; ++toLca, s = s->super) {
-        for (State *t = target; t; t = t->super) {
-            if (s == t) {
-                return toLca;
-            }
-        }
+    for (; s->depth > t->depth; s = s->super) {
+        ++toLca;                        /* climb to the level of the target */
+    }
+    while (t->depth > s->depth) {
+        t = t->super;                   /* climb to the level of the source */
     }
-    return 0;
+    for (; s != t; s = s->super, t = t->super) {
+        ++toLca;
+    }
+    return toLca;
+}
+
+/* find # of levels to LCA and cache them for the first (source, target)....*/
+unsigned char HsmFindLca_(Hsm *me, HsmLca *lca, State *target) {
+    unsigned char toLca = HsmToLCA_(me, target);
+    unsigned long long none = 0;
+    atomic_compare_exchange_strong_explicit(lca, &none,
+                                            HSM_LCA_KEY_(me, target) | toLca,
+                                            memory_order_relaxed,
+                                            memory_order_relaxed);
+    return toLca;
 }
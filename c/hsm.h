@@ -29,6 +29,13 @@
 #ifndef hsm_h
 #define hsm_h
 
+/* The LCA caches of STATE_TRAN() are C11 atomics (gcc -std=c11) */
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L \
+    || defined(__STDC_NO_ATOMICS__)
+#error "hsm.h requires C11 with <stdatomic.h>"
+#endif
+#include <stdatomic.h>
+
 typedef int Event;
 typedef struct {
     Event evt;
@@ -42,6 +49,8 @@ struct State {
     State *super;                                  /* pointer to superstate */
     EvtHndlr hndlr;                             /* state's handler function */
     char const *name;
+    unsigned char depth;                         /* nesting level (top is 0) */
+    State *sub;              /* substate on the entry path (engine scratch) */
 };
 
 void StateCtor(State *me, char const *name, State *super, EvtHndlr hndlr);
@@ -63,17 +72,32 @@ void HsmOnEvent(Hsm *me, Msg const *msg);                   /* "HSM engine" */
 /* protected: */
 unsigned char HsmToLCA_(Hsm *me, State *target);
 void HsmExit_(Hsm *me, unsigned char toLca);
+
+/* Least Common Ancestor of one (source, target) pair, cached by each
+ * STATE_TRAN(): the offsets of the states within the Hsm and the # of levels
+ * to exit, packed into one word, so one cache serves every instance of the
+ * state machine and it is written and read atomically (0 if not cached).
+ */
+typedef atomic_ullong HsmLca;
+unsigned char HsmFindLca_(Hsm *me, HsmLca *lca, State *target);
+#define HSM_LCA_KEY_(me_, target_) \
+    (((unsigned long long)((char *)(me_)->source - (char *)(me_)) << 40) \
+     | ((unsigned long long)((char *)(target_) - (char *)(me_)) << 8))
+static inline unsigned char HsmToLca_(Hsm *me, HsmLca *lca, State *target) {
+    unsigned long long l = atomic_load_explicit(lca, memory_order_relaxed);
+    return ((l & ~0xFFULL) == HSM_LCA_KEY_(me, target))
+           ? (unsigned char)l
+           : HsmFindLca_(me, lca, target);  /* not cached or another source */
+}
                                                        /* get current state */
 #define STATE_CURR(me_) (((Hsm *)me_)->curr)
                      /* take start transition (no states need to be exited) */
 #define STATE_START(me_, target_) (((Hsm *)me_)->next = (target_))
                      /* take a state transition (exit states up to the LCA) */
 #define STATE_TRAN(me_, target_) if (1) { \
-    static unsigned char toLca_ = 0xFF; \
+    static HsmLca lca_; \
     assert(((Hsm *)me_)->next == 0); \
-    if (toLca_ == 0xFF) \
-        toLca_ = HsmToLCA_((Hsm *)(me_), (target_)); \
-    HsmExit_((Hsm *)(me_), toLca_); \
+    HsmExit_((Hsm *)(me_), HsmToLca_((Hsm *)(me_), &lca_, (target_))); \
     ((Hsm *)(me_))->next = (target_); \
 } else ((void)0)
 
@@ -0,0 +1,190 @@
+/**  hsmbench.c -- Hierarchical State Machine engine benchmark.
+ *   Measures the cost of dispatching events handled in the current state
+ *   and in its superstates, of self- and cross-hierarchy transitions, and
+ *   of HsmOnStart() on a machine with two branches of 4 states.
+ *   Reports the best of BENCH_REPEAT runs in ns and TSC cycles per event.
+ *
+ *   usage: hsmbench [events-per-case]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+#include "hsm.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ULL      /* no cycle counter, cycles reported as 0 */
+#endif
+
+#define BENCH_REPEAT 5           /* # of runs of every case */
+
+typedef struct Bench Bench;
+struct Bench {
+    Hsm super;
+    State a1, a2, a3, a4;                         /* top-a1-a2-a3-a4 branch */
+    State b1, b2, b3, b4;                         /* top-b1-b2-b3-b4 branch */
+    unsigned long volatile nAct;      /* # of actions (not optimized away) */
+};
+
+enum BenchEvents {            /* LEVELn_SIG is handled by the states at level n */
+    LEVEL0_SIG, LEVEL1_SIG, LEVEL2_SIG, LEVEL3_SIG, LEVEL4_SIG,
+    SELF_SIG,                                 /* self-transition of a leaf */
+    CROSS_SIG                               /* transition to the other leaf */
+};
+
+/* actions common to the states at level n, 0 if the event is handled */
+static Msg const *BenchLevel(Bench *me, Msg const *msg, Event level) {
+    if (msg->evt == ENTRY_EVT || msg->evt == EXIT_EVT || msg->evt == level) {
+        ++me->nAct;
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Bench_top(Bench *me, Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(me, &me->a1);
+        return 0;
+    }
+    return BenchLevel(me, msg, LEVEL0_SIG);
+}
+
+Msg const *Bench_a1(Bench *me, Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(me, &me->a2);
+        return 0;
+    }
+    return BenchLevel(me, msg, LEVEL1_SIG);
+}
+
+Msg const *Bench_a2(Bench *me, Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(me, &me->a3);
+        return 0;
+    }
+    return BenchLevel(me, msg, LEVEL2_SIG);
+}
+
+Msg const *Bench_a3(Bench *me, Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(me, &me->a4);
+        return 0;
+    }
+    return BenchLevel(me, msg, LEVEL3_SIG);
+}
+
+Msg const *Bench_a4(Bench *me, Msg const *msg) {
+    switch (msg->evt) {
+    case SELF_SIG:
+        STATE_TRAN(me, &me->a4);
+        return 0;
+    case CROSS_SIG:
+        STATE_TRAN(me, &me->b4);
+        return 0;
+    }
+    return BenchLevel(me, msg, LEVEL4_SIG);
+}
+
+Msg const *Bench_b1(Bench *me, Msg const *msg) {
+    return BenchLevel(me, msg, LEVEL1_SIG);
+}
+
+Msg const *Bench_b2(Bench *me, Msg const *msg) {
+    return BenchLevel(me, msg, LEVEL2_SIG);
+}
+
+Msg const *Bench_b3(Bench *me, Msg const *msg) {
+    return BenchLevel(me, msg, LEVEL3_SIG);
+}
+
+Msg const *Bench_b4(Bench *me, Msg const *msg) {
+    switch (msg->evt) {
+    case SELF_SIG:
+        STATE_TRAN(me, &me->b4);
+        return 0;
+    case CROSS_SIG:
+        STATE_TRAN(me, &me->a4);
+        return 0;
+    }
+    return BenchLevel(me, msg, LEVEL4_SIG);
+}
+
+void BenchCtor(Bench *me) {
+    HsmCtor((Hsm *)me, "Bench", (EvtHndlr)Bench_top);
+    StateCtor(&me->a1, "a1", &((Hsm *)me)->top, (EvtHndlr)Bench_a1);
+      StateCtor(&me->a2, "a2", &me->a1, (EvtHndlr)Bench_a2);
+        StateCtor(&me->a3, "a3", &me->a2, (EvtHndlr)Bench_a3);
+          StateCtor(&me->a4, "a4", &me->a3, (EvtHndlr)Bench_a4);
+    StateCtor(&me->b1, "b1", &((Hsm *)me)->top, (EvtHndlr)Bench_b1);
+      StateCtor(&me->b2, "b2", &me->b1, (EvtHndlr)Bench_b2);
+        StateCtor(&me->b3, "b3", &me->b2, (EvtHndlr)Bench_b3);
+          StateCtor(&me->b4, "b4", &me->b3, (EvtHndlr)Bench_b4);
+    me->nAct = 0;
+}
+
+static double now(void) {                               /* time in [ns] */
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* run one case n times (HsmOnStart() if msg is 0), print the best run */
+static void run(Bench *me, char const *name, Msg const *msg, unsigned long n)
+{
+    double bestNs = 0.0;
+    double bestCyc = 0.0;
+    int r;
+    for (r = 0; r < BENCH_REPEAT; ++r) {
+        unsigned long i;
+        double t0 = now();
+        unsigned long long c0 = BENCH_CYCLES();
+        if (msg == 0) {
+            for (i = 0; i < n; ++i) {
+                HsmOnStart((Hsm *)me);
+            }
+        }
+        else {
+            for (i = 0; i < n; ++i) {
+                HsmOnEvent((Hsm *)me, msg);
+            }
+        }
+        c0 = BENCH_CYCLES() - c0;
+        t0 = now() - t0;
+        if (r == 0 || t0 < bestNs * n) {
+            bestNs = t0 / n;
+            bestCyc = (double)c0 / n;
+        }
+    }
+    printf("%-34s %8.2f %10.1f\n", name, bestNs, bestCyc);
+}
+
+static Msg const benchMsg[] = {
+    { LEVEL0_SIG }, { LEVEL1_SIG }, { LEVEL2_SIG }, { LEVEL3_SIG },
+    { LEVEL4_SIG }, { SELF_SIG }, { CROSS_SIG }
+};
+
+int main(int argc, char *argv[]) {
+    unsigned long n = (argc > 1) ? strtoul(argv[1], 0, 10) : 10000000UL;
+    Bench bench;
+    BenchCtor(&bench);
+    HsmOnStart((Hsm *)&bench);
+    assert(STATE_CURR(&bench) == &bench.a4);
+
+    printf("C engine, %lu events per case\n\n", n);
+    printf("case                                ns/evt  cycles/evt\n");
+    run(&bench, "handled in the current state", &benchMsg[LEVEL4_SIG], n);
+    run(&bench, "handled 1 level up", &benchMsg[LEVEL3_SIG], n);
+    run(&bench, "handled 2 levels up", &benchMsg[LEVEL2_SIG], n);
+    run(&bench, "handled 4 levels up (top)", &benchMsg[LEVEL0_SIG], n);
+    run(&bench, "self-transition", &benchMsg[SELF_SIG], n);
+    run(&bench, "cross transition (4 exit, 4 entry)", &benchMsg[CROSS_SIG], n);
+    run(&bench, "HsmOnStart (5 entry, 4 init)", 0, n);
+    return 0;
+}
@@ -1,3 +1,5 @@
-gcc watch.c hsm.c -o watch -pedantic -Wall -Wextra
+gcc -std=c11 watch.c hsm.c -o watch -pedantic -Wall -Wextra
 
-gcc hsmtst.c hsm.c -o hsmtst -pedantic -Wall -Wextra
+gcc -std=c11 hsmtst.c hsm.c -o hsmtst -pedantic -Wall -Wextra
+
+gcc -std=c11 -O2 hsmbench.c hsm.c -o hsmbench -pedantic -Wall -Wextra
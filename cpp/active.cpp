@@ -0,0 +1,282 @@
+//
+// active.cpp -- Active object implementation
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include "active.hpp"
+#include "evtpool.hpp"
+#include "sched.hpp"
+#include "timewheel.hpp"
+
+#define MAX_EVT_BATCH 32     // max # of queued events dispatched in one go
+
+// EvtQueue Ctor..............................................................
+EvtQueue::EvtQueue()
+  : sto(0), mask(0), head(0), tail(0)
+{}
+
+// initialize the ring buffer.................................................
+void EvtQueue::init(Cell *s, unsigned len) {
+    assert(len != 0 && (len & (len - 1)) == 0); // power of 2
+    sto = s;
+    mask = len - 1;
+    for (unsigned i = 0; i < len; ++i) {
+        sto[i].seq.store(i, std::memory_order_relaxed);
+    }
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+}
+
+// put an event into the queue (any thread)...................................
+bool EvtQueue::put(Msg const *msg) {
+    unsigned pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell *c = &sto[pos & mask];
+        int dif = (int)(c->seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0) { // cell free for this position?
+            if (head.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+            {
+                c->msg = msg;
+                c->seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (dif < 0) { // cell not consumed yet?
+            return false;   // queue full
+        }
+        else {
+            pos = head.load(std::memory_order_relaxed); // another producer
+        }
+    }
+}
+
+// get an event from the queue (consumer thread only).........................
+Msg const *EvtQueue::get() {
+    unsigned pos = tail.load(std::memory_order_relaxed);
+    Cell *c = &sto[pos & mask];
+    if (c->seq.load(std::memory_order_acquire) != pos + 1) {
+        return 0; // queue empty (or the producer has not finished yet)
+    }
+    Msg const *msg = c->msg;
+    c->seq.store(pos + mask + 1, std::memory_order_release);
+    tail.store(pos + 1, std::memory_order_relaxed);
+    return msg;
+}
+
+// check if the queue is empty (any thread)...................................
+bool EvtQueue::isEmpty() const {
+    unsigned pos = tail.load(std::memory_order_relaxed);
+    return sto[pos & mask].seq.load(std::memory_order_acquire) != pos + 1;
+}
+
+// Active Ctor................................................................
+Active::Active(char const *n, EvtHndlr topHndlr)
+  : Hsm(n, topHndlr), deferSto(0), deferMask(0), deferHead(0),
+    deferTail(0), waiting(false), running(false),
+    sched(0), scheduled(false), nextReady(0), timeEvts(0)
+{}
+
+// initialize the queue, start the thread and the state machine...............
+void Active::start(EvtQueue::Cell *qSto, unsigned qLen) {
+    assert(!running.load());
+    queue.init(qSto, qLen);
+    running.store(true);
+    thread = std::thread(&Active::run_, this);
+}
+
+// initialize the queue and start the state machine dispatched by a Sched.....
+void Active::start(EvtQueue::Cell *qSto, unsigned qLen, Sched *s) {
+    assert(!running.load() && sched == 0);
+    queue.init(qSto, qLen);
+    onStart(); // in the caller's thread, before any event is dispatched
+    sched = s;
+}
+
+// drain the queue and join the thread (not from the dispatcher thread).......
+// An AO dispatched by a Sched has no thread of its own: stop() waits until
+// the running Sched drained its queue, the Sched workers stay with the Sched.
+void Active::stop() {
+    if (sched != 0) {
+        while (!queue.isEmpty() || scheduled.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        return;
+    }
+    running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+    if (thread.joinable()) { // started and not stopped yet?
+        thread.join();
+    }
+}
+
+// post an event to the queue (any thread)....................................
+bool Active::post(Msg const *msg) {
+    evtRef(msg); // the queue holds a reference to a pool event
+    if (!queue.put(msg)) {
+        evtUnref_(msg);
+        return false; // queue full, the producer never waits
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sched != 0) { // dispatched by a Sched?
+        if (!scheduled.load(std::memory_order_relaxed)
+            && !scheduled.exchange(true, std::memory_order_acquire))
+        {
+            sched->ready(this); // this producer made the AO ready
+        }
+    }
+    else if (waiting.load(std::memory_order_relaxed)) { // dispatcher asleep?
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+    return true;
+}
+
+// provide the storage for the deferred events (before the start)...........
+void Active::deferInit(Msg const **sto, unsigned len) {
+    assert(len != 0 && (len & (len - 1)) == 0); // power of 2
+    deferSto = sto;
+    deferMask = len - 1;
+    deferHead = 0;
+    deferTail = 0;
+}
+
+// keep the event being dispatched to recall it later (in a handler).........
+// The event is not copied, the deferral holds a reference to a pool event.
+bool Active::defer(Msg const *msg) {
+    for (TimeEvt *te = timeEvts; te != 0; te = te->nextOfAo) {
+        assert(te != msg); // time events cannot be deferred
+    }
+    if (deferSto == 0 || deferHead - deferTail > deferMask) { // full?
+        return false;
+    }
+    evtRef(msg);
+    deferSto[deferHead & deferMask] = msg;
+    ++deferHead;
+    return true;
+}
+
+// post the oldest deferred event to the end of the own queue...............
+// returns false if there is none or the queue is full (it stays deferred)
+bool Active::recall() {
+    if (deferHead == deferTail) {
+        return false;
+    }
+    Msg const *msg = deferSto[deferTail & deferMask];
+    if (!post(msg)) {
+        return false;
+    }
+    ++deferTail;
+    evtUnref_(msg); // the queue holds the reference now
+    return true;
+}
+
+// dispatch msg and up to max - 1 more queued events, then release them......
+// A CallMsg ends the batch and runs after the events queued before it.
+// returns the # of events dispatched
+inline unsigned Active::dispatchBatch_(Msg const *msg, unsigned max) {
+    Msg const *batch[MAX_EVT_BATCH];
+    Msg const *call = 0;
+    unsigned n = 0;
+    if (max > MAX_EVT_BATCH) {
+        max = MAX_EVT_BATCH;
+    }
+    if (msg->evt == CALL_EVT) { // no events to dispatch before the call?
+        CallMsg const *c = static_cast<CallMsg const *>(msg);
+        (*c->call)(c);
+        return 1;
+    }
+    for (;;) {
+        batch[n++] = msg;
+        if (n == max || (msg = queue.get()) == 0) {
+            break;
+        }
+        if (msg->evt == CALL_EVT) {
+            call = msg;
+            break;
+        }
+    }
+    if (timeEvts == 0) {
+        onEvents(batch, n);
+    }
+    else {
+        for (unsigned i = 0; i < n; ++i) { // staleness known only now
+            if (!TimeEvt::isStale_(this, batch[i])) {
+                onEvent(batch[i]);
+            }
+        }
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        evtGc(batch[i]);
+    }
+    if (call != 0) {
+        CallMsg const *c = static_cast<CallMsg const *>(call);
+        (*c->call)(c);
+        ++n;
+    }
+    return n;
+}
+
+// dispatch events one at a time (run-to-completion)..........................
+void Active::run_() {
+    onStart();
+    for (;;) {
+        Msg const *msg = queue.get();
+        if (msg == 0) { // queue empty?
+            std::unique_lock<std::mutex> lock(mutex);
+            waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while ((msg = queue.get()) == 0 && running.load()) {
+                cond.wait(lock);
+            }
+            waiting.store(false, std::memory_order_relaxed);
+            if (msg == 0) {
+                break; // stopped with the queue drained
+            }
+        }
+        dispatchBatch_(msg, MAX_EVT_BATCH);
+    }
+}
+
+// dispatch up to max events in a Sched worker (the AO is scheduled)..........
+// returns true if the AO still has events and must be made ready again
+bool Active::dispatch_(unsigned max) {
+    while (max) {
+        Msg const *msg = queue.get();
+        if (msg == 0) { // queue empty?
+            scheduled.store(false, std::memory_order_seq_cst);
+            // an event posted before the store above did not schedule the AO
+            return !queue.isEmpty()
+                   && !scheduled.exchange(true, std::memory_order_acquire);
+        }
+        max -= dispatchBatch_(msg, max);
+    }
+    return true; // still has events, give other AOs a chance
+}
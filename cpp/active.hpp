@@ -0,0 +1,102 @@
+//
+// active.hpp -- Active object: Hsm with an event queue and a thread
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef ACTIVE_HPP_
+#define ACTIVE_HPP_
+
+#include "hsm.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class Sched; // forward declarations
+class TimeEvt;
+
+// CallMsg is run by the active object in its own thread instead of being
+// dispatched to the state machine, in the order of the event queue. It
+// resumes the coroutines of hsmco.hpp between the run-to-completion steps.
+// A CallMsg is owned by its poster, it is never a pool event.
+#define CALL_EVT ((Event)(-4))
+struct CallMsg : public Msg {
+    void (*call)(CallMsg const *me);
+};
+
+class EvtQueue { // bounded lock-free multiple-producer single-consumer queue
+public:
+    struct Cell {
+        std::atomic<unsigned> seq; // sequence number of the cell
+        Msg const *msg;
+    };
+    EvtQueue();
+    void init(Cell *sto, unsigned len); // len must be a power of 2
+    bool put(Msg const *msg); // any thread, returns false if full
+    Msg const *get();         // consumer thread only, returns 0 if empty
+    bool isEmpty() const;     // any thread, a snapshot only
+private:
+    Cell *sto;                     // ring buffer storage
+    unsigned mask;                 // ring buffer length - 1
+    alignas(64) std::atomic<unsigned> head; // next cell to put (producers)
+    alignas(64) std::atomic<unsigned> tail; // next cell to get (consumer)
+};
+
+class Active : public Hsm { // Hsm with its own event queue and thread
+public:
+    Active(char const *name, EvtHndlr topHndlr); // ctor
+    void start(EvtQueue::Cell *qSto, unsigned qLen); // onStart() + thread
+    void start(EvtQueue::Cell *qSto, unsigned qLen, Sched *s); // + sched
+    void stop();                  // drain the queue (and join the thread)
+    bool post(Msg const *msg);    // any thread, never blocks
+    void deferInit(Msg const **sto, unsigned len); // len a power of 2
+protected:
+    bool defer(Msg const *msg);   // keep msg for later, false if full
+    bool recall();                // post the oldest deferred event again
+private:
+    void run_();                  // the dispatcher thread routine
+    bool dispatch_(unsigned max); // dispatch from a Sched worker
+    unsigned dispatchBatch_(Msg const *msg, unsigned max);
+    EvtQueue queue;
+    Msg const **deferSto;         // deferred events (dispatcher thread only)
+    unsigned deferMask;           // deferred events storage length - 1
+    unsigned deferHead;           // # of events deferred
+    unsigned deferTail;           // # of events recalled
+    std::atomic<bool> waiting;    // dispatcher waits for an event
+    std::atomic<bool> running;
+    std::mutex mutex;             // protects only the waiting dispatcher
+    std::condition_variable cond;
+    std::thread thread;
+    Sched *sched;                 // scheduler dispatching this AO (or 0)
+    std::atomic<bool> scheduled;  // owned by one Sched worker at a time
+    Active *nextReady;            // link in the Sched list of ready AOs
+    TimeEvt *timeEvts;            // time events posted to this AO
+    friend class Sched;
+    friend class TimeEvt;
+};
+
+#endif // ACTIVE_HPP_
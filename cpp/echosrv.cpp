@@ -0,0 +1,268 @@
+//
+// Echo server of many connection machines driven by one Reactor thread.
+// The connections are Unix socket pairs, whose other ends are the clients
+// in the same thread, and one loopback TCP connection accepted by the
+// listener machine. The connection machines come from an HsmArena.
+//
+// Build (Linux, -DREACTOR_URING for io_uring):
+// g++ -O2 -DREACTOR_URING echosrv.cpp reactor.cpp hsm.cpp -o echosrv
+//
+// usage: echosrv [-e] [connections [rounds]]   (-e to use epoll)
+//
+#include "reactor.hpp"
+#include "hsmarena.hpp"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+
+#define MAX_CONNS 65536     // max # of connections
+
+enum EchoEvents {
+    DATA_SIG,               // IoEvt of a connection
+    ACCEPT_SIG              // IoEvt of the listening socket
+};
+
+static Reactor *l_reactor;
+static unsigned l_nOpen;    // # of connections open
+static unsigned long l_nEchoed; // # of messages echoed
+
+class Conn : public Hsm {
+    State open, closed;
+public:
+    IoSrc *src;
+    Conn();
+    void accept(int fd);
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *openHndlr(Msg const *msg);
+    Msg const *closedHndlr(Msg const *msg);
+};
+
+Msg const *Conn::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        src = 0; // the machines are recycled
+        STATE_START(&open);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Conn::openHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case DATA_SIG: {
+        IoEvt const *e = static_cast<IoEvt const *>(msg);
+        if (e->len <= 0) { // closed by the client?
+            STATE_TRAN(&closed);
+            return 0;
+        }
+        ssize_t n = write(src->fd, e->data, e->len); // the data not copied
+        assert(n == e->len);
+        (void)n;
+        ++l_nEchoed;
+        return 0;
+    }
+    }
+    return msg;
+}
+
+Msg const *Conn::closedHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT: {
+        int fd = src->fd;
+        l_reactor->remove(src);
+        close(fd);
+        --l_nOpen;
+        return 0;
+    }
+    }
+    return msg;
+}
+
+Conn::Conn()
+  : Hsm("Conn",             static_cast<EvtHndlr>(&Conn::topHndlr)),
+    open("open", &top,      static_cast<EvtHndlr>(&Conn::openHndlr)),
+    closed("closed", &top,  static_cast<EvtHndlr>(&Conn::closedHndlr)),
+    src(0)
+{
+    STATE_HANDLES(&open, DATA_SIG); // for HSM_SIG_TABLES
+}
+
+static HsmArena<Conn>::Slot l_connSto[MAX_CONNS];
+static HsmArena<Conn> l_conns;
+static Conn *l_conn[MAX_CONNS];
+static unsigned l_nConns;
+
+// serve a new connection.....................................................
+void Conn::accept(int fd) {
+    src = l_reactor->addReader(fd, this, DATA_SIG);
+    assert(src != 0);
+    ++l_nOpen;
+}
+
+static void newConn(int fd) {
+    assert(l_nConns < MAX_CONNS);
+    Conn *c = l_conns.get();
+    assert(c != 0);
+    c->accept(fd);
+    l_conn[l_nConns++] = c;
+}
+
+class Listener : public Hsm {
+    State listening;
+public:
+    Listener();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *listeningHndlr(Msg const *msg);
+};
+
+Msg const *Listener::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        STATE_START(&listening);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Listener::listeningHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ACCEPT_SIG: {
+        int fd = accept4(static_cast<IoEvt const *>(msg)->src->fd, 0, 0,
+                         SOCK_CLOEXEC);
+        if (fd >= 0) {
+            newConn(fd);
+        }
+        return 0;
+    }
+    }
+    return msg;
+}
+
+Listener::Listener()
+  : Hsm("Listener",               static_cast<EvtHndlr>(&Listener::topHndlr)),
+    listening("listening", &top,  static_cast<EvtHndlr>(&Listener::listeningHndlr))
+{
+    STATE_HANDLES(&listening, ACCEPT_SIG); // for HSM_SIG_TABLES
+}
+
+// dispatch the events until the machines echoed the messages..............
+static void pollUntil(unsigned long nEchoed, unsigned nOpen) {
+    while (l_nEchoed < nEchoed || l_nOpen != nOpen) {
+        l_reactor->poll(1000);
+    }
+}
+
+// send a message to every client and read its echo..........................
+static void echoRound(int const *client, unsigned n, unsigned r) {
+    char msg[32];
+    int len = snprintf(msg, sizeof(msg), "ping %u", r);
+    for (unsigned i = 0; i < n; ++i) {
+        ssize_t w = write(client[i], msg, len);
+        assert(w == len);
+        (void)w;
+    }
+    pollUntil(l_nEchoed + n, l_nOpen);
+    for (unsigned i = 0; i < n; ++i) {
+        char echo[32];
+        ssize_t e = read(client[i], echo, sizeof(echo));
+        assert(e == len && memcmp(echo, msg, len) == 0);
+        (void)e;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool uring = true;
+    int a = 1;
+    if (a < argc && strcmp(argv[a], "-e") == 0) {
+        uring = false;
+        ++a;
+    }
+    long n = (a < argc) ? atol(argv[a]) : 8000;
+    long rounds = (a + 1 < argc) ? atol(argv[a + 1]) : 50;
+    if (n < 1 || n > MAX_CONNS || rounds < 1) {
+        fprintf(stderr, "usage: echosrv [-e] [connections [rounds]]\n"
+                        "connections: 1..%d, rounds: 1..\n", MAX_CONNS);
+        return 1;
+    }
+    // 2 descriptors per connection, as many as the hard limit allows
+    rlimit lim;
+    getrlimit(RLIMIT_NOFILE, &lim);
+    if (lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    if ((rlim_t)n * 2 + 16 > lim.rlim_cur) {
+        fprintf(stderr, "echosrv: %ld connections need %ld descriptors, "
+                "the limit is %lu\n", n, n * 2 + 16,
+                (unsigned long)lim.rlim_cur);
+        return 1;
+    }
+
+    Reactor reactor(n + 2, uring);
+    l_reactor = &reactor;
+    l_conns.init(l_connSto, MAX_CONNS);
+
+    // one loopback TCP connection, accepted by the listener
+    int lsn = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    int r = bind(lsn, (sockaddr *)&addr, sizeof(addr));
+    assert(r == 0);
+    r = listen(lsn, 16);
+    assert(r == 0);
+    r = getsockname(lsn, (sockaddr *)&addr, &addrLen);
+    assert(r == 0);
+    (void)r;
+    Listener listener;
+    listener.onStart();
+    IoSrc *lsnSrc = reactor.addWatcher(lsn, &listener, ACCEPT_SIG);
+    static int client[MAX_CONNS];
+    client[0] = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    r = connect(client[0], (sockaddr *)&addr, sizeof(addr));
+    assert(r == 0);
+    pollUntil(0, 1);
+
+    for (unsigned i = 1; i < (unsigned)n; ++i) { // the other connections
+        int sv[2];
+        r = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv);
+        assert(r == 0);
+        client[i] = sv[0];
+        newConn(sv[1]);
+    }
+
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    for (unsigned k = 0; k < (unsigned)rounds; ++k) {
+        echoRound(client, n, k);
+    }
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t0).count();
+
+    for (unsigned i = 0; i < (unsigned)n; ++i) { // the clients close
+        close(client[i]);
+    }
+    pollUntil(l_nEchoed, 0);
+    for (unsigned i = 0; i < l_nConns; ++i) {
+        l_conns.put(l_conn[i]);
+    }
+    reactor.remove(lsnSrc);
+    reactor.poll(0);
+    close(lsn);
+
+    printf("%s: %ld connections, %lu messages echoed, %.0f kmsg/s\n",
+           reactor.isUring() ? "io_uring" : "epoll", n, l_nEchoed,
+           l_nEchoed / s / 1000.0);
+    assert(l_nEchoed == (unsigned long)n * rounds);
+    return 0;
+}
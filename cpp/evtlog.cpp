@@ -0,0 +1,172 @@
+//
+// evtlog.cpp -- Event log recording and replay
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include <string.h>
+#include "evtlog.hpp"
+
+#include <chrono>
+#include <thread>
+
+#define REC_HDR_SIZE 16     // time, machine id and event size
+
+// EvtLog Ctor................................................................
+EvtLog::EvtLog()
+  : f(0)
+{}
+
+// create the log or open it for appending....................................
+bool EvtLog::open(char const *path) {
+    assert(f == 0);
+    f = fopen(path, "ab");
+    if (f == 0) {
+        return false;
+    }
+    if (ftell(f) == 0) { // a new log?
+        EvtLogHdr hdr;
+        memcpy(hdr.magic, "HSMEVLG2", sizeof(hdr.magic));
+        if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+// close the log..............................................................
+bool EvtLog::close() {
+    bool ok = (f != 0) && (fclose(f) == 0);
+    f = 0;
+    return ok;
+}
+
+// append an event to the log (any thread)....................................
+void EvtLog::record(unsigned hsm, Msg const *msg, unsigned size) {
+    assert(size >= sizeof(Msg) && size <= EVTLOG_MAX_EVT);
+    unsigned long long t = (unsigned long long)
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    unsigned char rec[REC_HDR_SIZE + EVTLOG_MAX_EVT];
+    memcpy(&rec[0], &t, sizeof(t));
+    memcpy(&rec[8], &hsm, sizeof(hsm));
+    memcpy(&rec[12], &size, sizeof(size));
+    memcpy(&rec[REC_HDR_SIZE], msg, size);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (f != 0) {
+        fwrite(rec, REC_HDR_SIZE + size, 1, f); // a full disk shows in close
+    }
+}
+
+// write the buffered records to the file.....................................
+bool EvtLog::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (f != 0) && (fflush(f) == 0);
+}
+
+// EvtReplay Ctor.............................................................
+EvtReplay::EvtReplay()
+  : nUnknown(0), log(0), len(0)
+{}
+
+// EvtReplay Xtor.............................................................
+EvtReplay::~EvtReplay() {
+    delete[] log;
+}
+
+// load the whole log into memory.............................................
+bool EvtReplay::open(char const *path) {
+    delete[] log;
+    log = 0;
+    len = 0;
+    FILE *f = fopen(path, "rb");
+    if (f == 0) {
+        return false;
+    }
+    EvtLogHdr hdr;
+    long end = -1;
+    if (fread(&hdr, sizeof(hdr), 1, f) == 1
+        && memcmp(hdr.magic, "HSMEVLG2", sizeof(hdr.magic)) == 0
+        && fseek(f, 0, SEEK_END) == 0)
+    {
+        end = ftell(f);
+    }
+    if (end >= (long)sizeof(hdr) && fseek(f, sizeof(hdr), SEEK_SET) == 0) {
+        len = (size_t)end - sizeof(hdr);
+        log = new unsigned char[len];
+        if (fread(log, 1, len, f) != len) {
+            delete[] log;
+            log = 0;
+            len = 0;
+            end = -1;
+        }
+    }
+    fclose(f);
+    return end >= 0;
+}
+
+// dispatch the logged events.................................................
+unsigned long EvtReplay::replay(Hsm * const *hsm, unsigned nHsm,
+                                bool realTime)
+{
+    alignas(max_align_t) unsigned char evt[EVTLOG_MAX_EVT];
+    unsigned long n = 0;
+    unsigned long long tFirst = 0;
+    nUnknown = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos + REC_HDR_SIZE <= len; ) {
+        unsigned long long t;
+        unsigned id, size;
+        memcpy(&t, &log[pos], sizeof(t));
+        memcpy(&id, &log[pos + 8], sizeof(id));
+        memcpy(&size, &log[pos + 12], sizeof(size));
+        pos += REC_HDR_SIZE;
+        if (size < sizeof(Msg) || size > EVTLOG_MAX_EVT || size > len - pos) {
+            break; // truncated by a crash
+        }
+        if (id >= nHsm) { // a log of more machines
+            ++nUnknown;
+            pos += size;
+            continue;
+        }
+        memcpy(evt, &log[pos], size);
+        pos += size;
+        if (realTime) {
+            if (n == 0) {
+                tFirst = t;
+            }
+            else if (t > tFirst) {
+                std::this_thread::sleep_until(
+                    start + std::chrono::nanoseconds(t - tFirst));
+            }
+        }
+        hsm[id]->onEvent((Msg const *)evt);
+        ++n;
+    }
+    return n;
+}
@@ -0,0 +1,86 @@
+//
+// evtlog.hpp -- Event log recording and replay
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef EVTLOG_HPP_
+#define EVTLOG_HPP_
+
+#include "hsm.hpp"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <mutex>
+
+#ifndef EVTLOG_MAX_EVT
+#define EVTLOG_MAX_EVT 256  // max size of a logged event (Msg and parameters)
+#endif
+
+// EvtLog appends every recorded event to a binary log file: the time, the
+// id of the machine and the event with its parameters as they are, so the
+// events must be plain data. Any thread can record. EvtReplay feeds a log
+// back through Hsm::onEvent() at full speed or at the recorded speed.
+//
+// Log file: EvtLogHdr, then the records: the system time in [ns] since
+// the epoch as an unsigned long long, the machine id and the event size
+// as unsigneds (16 bytes), then the event. A log opened again is appended
+// to.
+class EvtLog {
+public:
+    EvtLog();                       // ctor
+    bool open(char const *path);    // create or append, false on error
+    bool close();                   // false on error
+    void record(unsigned hsm, Msg const *msg, unsigned size);
+    bool flush();                   // write the buffered records
+private:
+    FILE *f;
+    std::mutex mutex;               // serializes the recording threads
+};
+
+// record an event with its parameters (the event type evtT_)
+#define EVT_LOG(log_, hsm_, msg_, evtT_) \
+    ((log_)->record((hsm_), (msg_), sizeof(evtT_)))
+
+class EvtReplay {
+public:
+    EvtReplay();                    // ctor
+    ~EvtReplay();                   // xtor
+    bool open(char const *path);    // load the whole log, false on error
+    // dispatch the events to the machines hsm[id], at the recorded speed
+    // if realTime, returns the # of events dispatched; the events of the
+    // ids >= nHsm are skipped and counted in nUnknown
+    unsigned long replay(Hsm * const *hsm, unsigned nHsm, bool realTime);
+    unsigned long nUnknown;         // events skipped by the last replay()
+private:
+    unsigned char *log;             // the records
+    size_t len;
+};
+
+struct EvtLogHdr {
+    char magic[8];                  // "HSMEVLG2"
+};
+
+#endif // EVTLOG_HPP_
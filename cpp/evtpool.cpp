@@ -0,0 +1,148 @@
+//
+// evtpool.cpp -- Reference-counted events in fixed-block pools
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include <new>
+#include "evtpool.hpp"
+
+static EvtPool l_pool[MAX_EVT_POOLS]; // event pools, smallest events first
+static unsigned l_nPools;             // # of initialized event pools
+
+// find the pool of an event (0 for a static event)...........................
+static EvtPool *poolOf_(Msg const *msg) {
+    for (unsigned p = 0; p < l_nPools; ++p) {
+        if (l_pool[p].owns(msg)) {
+            return &l_pool[p];
+        }
+    }
+    return 0;
+}
+
+// initialize the pool in the given storage...................................
+void EvtPool::init(void *s, unsigned stoSize, unsigned size) {
+    blockSize = (HDR_SIZE + size + alignof(max_align_t) - 1)
+                & ~(unsigned)(alignof(max_align_t) - 1);
+    evtSize = blockSize - HDR_SIZE;
+    sto = (char *)(((size_t)s + alignof(max_align_t) - 1)
+                   & ~(alignof(max_align_t) - 1));
+    unsigned n = (unsigned)(((char *)s + stoSize - sto) / blockSize);
+    assert(n > 0);
+    end = sto + n * blockSize;
+    for (unsigned i = 0; i < n; ++i) { // link all blocks in the free list
+        new (hdr_(i)) Hdr;
+        hdr_(i)->next.store(i + 1 < n ? i + 2 : 0, std::memory_order_relaxed);
+    }
+    freeHead.store(1, std::memory_order_relaxed);
+    nFree.store(n, std::memory_order_relaxed);
+    nMin.store(n, std::memory_order_relaxed);
+}
+
+// get a block from the pool (any thread).....................................
+Msg *EvtPool::get() {
+    unsigned long long head = freeHead.load(std::memory_order_acquire);
+    for (;;) {
+        unsigned idx = (unsigned)head;
+        if (idx == 0) {
+            return 0; // pool empty
+        }
+        Hdr *h = hdr_(idx - 1);
+        unsigned long long next = ((head >> 32) + 1) << 32 // bump ABA tag
+                                  | h->next.load(std::memory_order_relaxed);
+        if (freeHead.compare_exchange_weak(head, next,
+                std::memory_order_acquire, std::memory_order_acquire))
+        {
+            unsigned n = nFree.fetch_sub(1, std::memory_order_relaxed) - 1;
+            if (n < nMin.load(std::memory_order_relaxed)) {
+                nMin.store(n, std::memory_order_relaxed); // approximate
+            }
+            h->refCtr.store(0, std::memory_order_relaxed);
+            return (Msg *)((char *)h + HDR_SIZE);
+        }
+    }
+}
+
+// return a block to the pool (any thread)....................................
+void EvtPool::put(Msg const *msg) {
+    assert(owns(msg));
+    Hdr *h = hdrOf_(msg);
+    unsigned idx = (unsigned)(((char *)h - sto) / blockSize) + 1;
+    unsigned long long head = freeHead.load(std::memory_order_relaxed);
+    do {
+        h->next.store((unsigned)head, std::memory_order_relaxed);
+    } while (!freeHead.compare_exchange_weak(head,
+                 (((head >> 32) + 1) << 32) | idx,
+                 std::memory_order_release, std::memory_order_relaxed));
+    nFree.fetch_add(1, std::memory_order_relaxed);
+}
+
+// initialize the next event pool.............................................
+void evtPoolInit(void *sto, unsigned stoSize, unsigned evtSize) {
+    assert(l_nPools < MAX_EVT_POOLS);
+    assert(l_nPools == 0 || l_pool[l_nPools - 1].evtSize < evtSize);
+    l_pool[l_nPools].init(sto, stoSize, evtSize);
+    ++l_nPools;
+}
+
+// allocate an event from the smallest pool that fits........................
+Msg *evtNew_(unsigned evtSize, Event evt) {
+    for (unsigned p = 0; p < l_nPools; ++p) {
+        if (evtSize <= l_pool[p].evtSize) {
+            Msg *msg = l_pool[p].get();
+            if (msg != 0) {
+                msg->evt = evt;
+            }
+            return msg;
+        }
+    }
+    assert(0); // no pool for events of this size
+    return 0;
+}
+
+// add a reference to a pool event (static events are ignored)................
+void evtRef(Msg const *msg) {
+    EvtPool *pool = poolOf_(msg);
+    if (pool != 0) {
+        pool->ref(msg);
+    }
+}
+
+// drop a reference to a pool event and recycle it if it was the last........
+void evtGc(Msg const *msg) {
+    EvtPool *pool = poolOf_(msg);
+    if (pool != 0 && pool->unref(msg)) {
+        pool->put(msg); // also an event that was never posted
+    }
+}
+
+// drop a reference that did not reach any queue (e.g., a failed post).......
+void evtUnref_(Msg const *msg) {
+    EvtPool *pool = poolOf_(msg);
+    if (pool != 0) {
+        pool->unref(msg);
+    }
+}
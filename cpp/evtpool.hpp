@@ -0,0 +1,93 @@
+//
+// evtpool.hpp -- Reference-counted events in fixed-block pools
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef EVTPOOL_HPP_
+#define EVTPOOL_HPP_
+
+#include "hsm.hpp"
+
+#include <atomic>
+#include <stddef.h>
+
+#define MAX_EVT_POOLS 3
+
+// Events with parameters are structures derived from Msg, allocated from
+// one of up to MAX_EVT_POOLS pools of fixed-size blocks. Every block
+// starts with a hidden header holding the reference counter of the event,
+// so one event can be posted to many active objects without copying it.
+// The event is recycled when the last of them has processed it.
+class EvtPool {
+public:
+    void init(void *sto, unsigned stoSize, unsigned evtSize);
+    Msg *get();                    // any thread, returns 0 if empty
+    void put(Msg const *msg);      // any thread
+    bool owns(Msg const *msg) const {
+        return (char const *)msg >= sto && (char const *)msg < end;
+    }
+    void ref(Msg const *msg) {     // add a reference
+        hdrOf_(msg)->refCtr.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool unref(Msg const *msg) {   // drop a reference, true if the last one
+        return hdrOf_(msg)->refCtr.fetch_sub(1, std::memory_order_acq_rel)
+               <= 1;
+    }
+    unsigned evtSize;              // max size of the events in the pool
+    std::atomic<unsigned> nMin;    // min # of free blocks (low watermark)
+private:
+    struct Hdr {                   // hidden header of every block
+        std::atomic<unsigned> refCtr; // # of references while allocated
+        std::atomic<unsigned> next;   // next free block (index + 1)
+    };
+    enum { HDR_SIZE = (sizeof(Hdr) + alignof(max_align_t) - 1)
+                      & ~(alignof(max_align_t) - 1) };
+    Hdr *hdr_(unsigned idx) const {
+        return (Hdr *)(sto + idx * blockSize);
+    }
+    static Hdr *hdrOf_(Msg const *msg) {
+        return (Hdr *)((char *)msg - HDR_SIZE);
+    }
+    char *sto;                     // first block
+    char *end;                     // end of the last block
+    unsigned blockSize;
+    std::atomic<unsigned long long> freeHead; // ABA tag, index + 1
+    std::atomic<unsigned> nFree;
+};
+
+// initialize the next event pool, the pools must be initialized in the
+// order of increasing event sizes
+void evtPoolInit(void *sto, unsigned stoSize, unsigned evtSize);
+Msg *evtNew_(unsigned evtSize, Event evt); // returns 0 if the pool is empty
+void evtRef(Msg const *msg);      // add a reference (to a pool event)
+void evtGc(Msg const *msg);       // drop a reference, recycle if the last
+void evtUnref_(Msg const *msg);   // drop a reference, never recycle
+
+// allocate an event of the given type, returns 0 if the pool is empty
+#define EVT_NEW(evtT_, evt_) \
+    (static_cast<evtT_ *>(evtNew_(sizeof(evtT_), (evt_))))
+
+#endif // EVTPOOL_HPP_
@@ -0,0 +1,132 @@
+//
+// evtreplay.cpp -- Event log recording and replay of HsmTest machines
+// With events given, sends random events to the machines while recording
+// them into a new log, then replays the log into new machines, which must
+// end in the same states. Without, replays an existing log (at the
+// recorded speed with -t). Reports the events per second of each run.
+//
+// Build:
+// g++ -O2 -DHSMTST_QUIET -DHSMTST_NO_MAIN evtreplay.cpp evtlog.cpp
+//     hsmtst.cpp hsm.cpp -o evtreplay -pthread
+//
+// Compiled with HSM_PROFILE (and hsmprof.cpp), saves the profile of the
+// states as folded stacks for flame graphs into evtreplay.prof.
+//
+// usage: evtreplay [-t] log [machines [events]]
+//
+#include "evtlog.hpp"
+#include "hsmtst.hpp"
+#ifdef HSM_PROFILE
+#include "hsmprof.hpp"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+class HsmTestLog : public HsmTest { // HsmTest exposing its current state
+public:
+    unsigned short stateOffset() {
+        return (unsigned short)((char *)STATE_CURR() - (char *)this);
+    }
+};
+
+// start n machines, returns the array of pointers to them....................
+static Hsm **startAll(HsmTestLog *m, unsigned n) {
+    Hsm **p = new Hsm *[n];
+    for (unsigned i = 0; i < n; ++i) {
+        p[i] = &m[i];
+        m[i].onStart();
+    }
+    return p;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char *argv[]) {
+    bool realTime = (argc > 1 && strcmp(argv[1], "-t") == 0);
+    if (realTime) {
+        --argc;
+        ++argv;
+    }
+    if (argc < 2) {
+        printf("usage: evtreplay [-t] log [machines [events]]\n");
+        return 1;
+    }
+    unsigned n = (argc > 2) ? (unsigned)atoi(argv[2]) : 1000;
+    unsigned long nEvt = (argc > 3) ? (unsigned long)atol(argv[3]) : 0;
+    assert(n != 0);
+
+    HsmTestLog *orig = 0;
+    if (nEvt != 0) { // record a new log
+        EvtLog log;
+        remove(argv[1]);
+        if (!log.open(argv[1])) {
+            printf("%s: cannot create\n", argv[1]);
+            return 1;
+        }
+        orig = new HsmTestLog[n];
+        Hsm **p = startAll(orig, n);
+        unsigned rnd = 1;
+        std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        for (unsigned long k = 0; k < nEvt; ++k) {
+            rnd = rnd * 1103515245U + 12345U;
+            unsigned id = (rnd >> 8) % n;
+            Msg const *msg = &HsmTestMsg[(rnd >> 24) % (H_SIG + 1)];
+            EVT_LOG(&log, id, msg, Msg);
+            p[id]->onEvent(msg);
+        }
+        if (!log.close()) {
+            printf("%s: write error\n", argv[1]);
+            return 1;
+        }
+        printf("recorded %lu events: %.2f Mevt/s\n",
+               nEvt, nEvt / secondsSince(t0) / 1e6);
+        delete[] p;
+    }
+
+    EvtReplay replay;
+    if (!replay.open(argv[1])) {
+        printf("%s: not an event log\n", argv[1]);
+        return 1;
+    }
+    HsmTestLog *copy = new HsmTestLog[n];
+    Hsm **p = startAll(copy, n);
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    unsigned long k = replay.replay(p, n, realTime);
+    printf("replayed %lu events: %.2f Mevt/s\n",
+           k, k / secondsSince(t0) / 1e6);
+    if (replay.nUnknown != 0) {
+        printf("%lu events of machines >= %u skipped\n", replay.nUnknown, n);
+    }
+    if (orig != 0) { // check the replayed machines against the recorded
+        assert(k == nEvt && replay.nUnknown == 0);
+        for (unsigned i = 0; i < n; ++i) {
+            assert(orig[i].stateOffset() == copy[i].stateOffset());
+        }
+        printf("all %u machines replayed into the recorded states\n", n);
+        delete[] orig;
+    }
+#ifdef HSM_PROFILE
+    ProfCounters s11;
+    if (profGet("HsmTest;s1;s11", &s11)) {
+        printf("s11: %llu handled, %llu passed, %llu entries, %llu exits\n",
+               s11.handled, s11.passed, s11.entries, s11.exits);
+    }
+    FILE *f = fopen("evtreplay.prof", "w"); // flamegraph.pl evtreplay.prof
+    if (f != 0) {
+        profDump(f);
+        fclose(f);
+    }
+#endif
+    delete[] p;
+    delete[] copy;
+    return 0;
+}
@@ -0,0 +1,162 @@
+//
+// Ticks of one clock published to many watch active objects on a Sched.
+// Every tick is a pool event shared by all its subscribers, and the pool
+// holds only a few of them, so the clock can publish the next tick only
+// after the watches have processed and recycled an earlier one. Some of
+// the watches unsubscribe from the ticks halfway, some subscribe also to
+// the alarms.
+//
+// Build:
+// g++ -O2 fanout.cpp pubsub.cpp sched.cpp active.cpp evtpool.cpp hsm.cpp
+//     -o fanout -pthread
+//
+// usage: fanout [watches [ticks]]
+//
+#include "evtpool.hpp"
+#include "pubsub.hpp"
+#include "sched.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#define QUEUE_LEN   8       // event queue length of every watch
+#define N_WORKERS   4       // # of Sched worker threads
+#define POOL_SIZE   128     // pool of fewer tick events than QUEUE_LEN
+
+enum WatchEvents {
+    Watch_TICK_EVT,         // TickEvt from the pool
+    Watch_ALARM_EVT,        // static event
+    Watch_MAX_EVT
+};
+
+struct TickEvt : public Msg {
+    unsigned seq;           // # of the tick
+};
+
+class WatchSub : public Active {
+protected:
+    State timekeeping;
+public:
+    unsigned nTicks, nAlarms;
+    unsigned lastSeq;       // seq of the last tick received
+    WatchSub();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *timekeepingHndlr(Msg const *msg);
+};
+
+Msg const *WatchSub::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        STATE_START(&timekeeping);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *WatchSub::timekeepingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_TICK_EVT: {
+        unsigned seq = static_cast<TickEvt const *>(msg)->seq;
+        assert(seq > lastSeq); // in the order of publishing
+        lastSeq = seq;
+        ++nTicks;
+        return 0;
+    }
+    case Watch_ALARM_EVT:
+        ++nAlarms;
+        return 0;
+    }
+    return msg;
+}
+
+WatchSub::WatchSub()
+  : Active("WatchSub",                static_cast<EvtHndlr>(&WatchSub::topHndlr)),
+    timekeeping("timekeeping", &top, static_cast<EvtHndlr>(&WatchSub::timekeepingHndlr)),
+    nTicks(0), nAlarms(0), lastSeq(0)
+{
+    STATE_HANDLES(&timekeeping, Watch_TICK_EVT); // for HSM_SIG_TABLES
+    STATE_HANDLES(&timekeeping, Watch_ALARM_EVT);
+}
+
+static Msg const alarmMsg = { Watch_ALARM_EVT };
+
+// allocate all free events of the pool and recycle them, returns their #....
+static unsigned nFreeTicks() {
+    static Msg *e[POOL_SIZE / sizeof(TickEvt)]; // more than the blocks
+    unsigned n = 0;
+    while ((e[n] = EVT_NEW(TickEvt, Watch_TICK_EVT)) != 0) {
+        ++n;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        evtGc(e[i]); // never posted
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned nAo = (argc > 1) ? (unsigned)atoi(argv[1]) : 5000;
+    unsigned nTicks = (argc > 2) ? (unsigned)atoi(argv[2]) : 200;
+    assert(nAo > 0);
+    static char poolSto[POOL_SIZE];
+    evtPoolInit(poolSto, sizeof(poolSto), sizeof(TickEvt));
+    unsigned nPool = nFreeTicks();
+
+    WatchSub *watch = new WatchSub[nAo];
+    EvtQueue::Cell *qSto = new EvtQueue::Cell[nAo * QUEUE_LEN];
+    Sched sched(N_WORKERS, nAo);
+    PubSub pubsub(Watch_MAX_EVT, nAo);
+    for (unsigned i = 0; i < nAo; ++i) {
+        watch[i].start(&qSto[i * QUEUE_LEN], QUEUE_LEN, &sched);
+        unsigned id = pubsub.add(&watch[i]);
+        pubsub.subscribe(id, Watch_TICK_EVT);
+        if (id % 3 == 0) {
+            pubsub.subscribe(id, Watch_ALARM_EVT);
+        }
+    }
+    sched.start();
+
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    unsigned long nPosts = 0;
+    unsigned nAlarms = 0;
+    for (unsigned k = 1; k <= nTicks; ++k) {
+        TickEvt *e;
+        while ((e = EVT_NEW(TickEvt, Watch_TICK_EVT)) == 0) {
+            std::this_thread::yield(); // all ticks still being processed
+        }
+        e->seq = k;
+        nPosts += pubsub.publish(e);
+        if (k % 10 == 0) {
+            nPosts += pubsub.publish(&alarmMsg);
+            ++nAlarms;
+        }
+        if (k == nTicks / 2) {
+            for (unsigned id = 0; id < nAo; id += 4) {
+                pubsub.unsubscribe(id, Watch_TICK_EVT);
+            }
+        }
+    }
+    for (unsigned i = 0; i < nAo; ++i) {
+        watch[i].stop(); // all the posted events processed
+    }
+    double s = std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - t0).count();
+    sched.stop();
+
+    unsigned long nRecv = 0;
+    for (unsigned i = 0; i < nAo; ++i) {
+        assert(watch[i].nTicks == ((i % 4 == 0) ? nTicks / 2 : nTicks));
+        assert(watch[i].nAlarms == ((i % 3 == 0) ? nAlarms : 0));
+        nRecv += watch[i].nTicks + watch[i].nAlarms;
+    }
+    printf("%u watches, %u ticks: %lu events delivered, %.2f Mevt/s, "
+           "%u lost\n", nAo, nTicks, nRecv, nRecv / s / 1e6,
+           pubsub.nLost.load());
+    assert(nRecv == nPosts && pubsub.nLost.load() == 0);
+    assert(nFreeTicks() == nPool); // every shared tick recycled
+    delete[] qSto;
+    delete[] watch;
+    return 0;
+}
@@ -27,107 +27,611 @@
 // miro@quantum-leaps.com
 //
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "hsm.hpp"
 
+#ifdef HSM_TRACE
+#include "hsmtrace.hpp"
+#define HSM_TRACE_(kind_, state_, evt_) \
+    traceRec((kind_), traceId, name_(state_), (evt_))
+#else
+#define HSM_TRACE_(kind_, state_, evt_) ((void)0)
+#endif
+
+#ifdef HSM_PROFILE
+#include "hsmprof.hpp"
+#define HSM_PROF_BEGIN_() ProfMark const prof_ = profBegin_()
+#define HSM_PROF_END_(state_, kind_) profEnd_(prof_, (state_)->profId, (kind_))
+#else
+#define HSM_PROF_BEGIN_() ((void)0)
+#define HSM_PROF_END_(state_, kind_) ((void)0)
+#endif
+
 static Msg const startMsg = { START_EVT };
 static Msg const entryMsg = { ENTRY_EVT };
 static Msg const exitMsg  = { EXIT_EVT };
-#define MAX_STATE_NESTING 8
 
-// State Ctor.................................................................
+#if defined(HSM_STATE_TABLES) || defined(HSM_SIG_TABLES)
+#include <atomic>
+
+static std::atomic_flag l_stateLock = ATOMIC_FLAG_INIT; // guards the tables
+
+static void stateLock_() {
+    while (l_stateLock.test_and_set(std::memory_order_acquire)) {
+    }
+}
+
+static void stateUnlock_() {
+    l_stateLock.clear(std::memory_order_release);
+}
+#endif
+
+// report a broken limit of the class tables, also without asserts..........
+static void tblFail_(char const *what) {
+    fprintf(stderr, "hsm: %s\n", what);
+    abort();
+}
+
+// a state too far from its Hsm for the 16-bit offsets.......................
+void Hsm::offsetFail_() {
+    tblFail_("a state farther than HSM_MAX_OFFSET from its machine");
+}
+
+#ifdef HSM_SIG_TABLES
+static SigTbl l_sigTbl[HSM_MAX_CLASSES];
+static unsigned l_nSigTbls;
+
+// find or create the signal tables of a machine class.......................
+static SigTbl *sigTblOf_(EvtHndlr topHndlr) {
+    SigTbl *tbl;
+    for (tbl = l_sigTbl; tbl != &l_sigTbl[l_nSigTbls]; ++tbl) {
+        if (tbl->topHndlr == topHndlr) {
+            return tbl;
+        }
+    }
+    if (l_nSigTbls == HSM_MAX_CLASSES) {
+        tblFail_("more machine classes than HSM_MAX_CLASSES");
+    }
+    ++l_nSigTbls;
+    for (unsigned r = 0; r < HSM_MAX_STATES; ++r) {
+        for (unsigned i = 0; i < HSM_MAX_SIG; ++i) {
+            tbl->row[r][i].store(SIG_UNKNOWN, std::memory_order_relaxed);
+        }
+    }
+    tbl->topHndlr = topHndlr;
+    tbl->n = 0;
+    return tbl;
+}
+#endif
+
+#ifdef HSM_STATE_TABLES
+#define HSM_MAX_NESTED 4    // max # of machines constructed one in another
+
+static StateTbl l_stateTbl[HSM_MAX_CLASSES];
+static unsigned l_nStateTbls;
+
+// The machines of this thread whose states may still be constructed, the
+// last one on top. A machine is dropped when a state of a machine below it
+// is constructed (it was a member of that one) or when another machine of
+// its class is constructed (the class has no member of its own class), so
+// the stack holds at most one machine per class besides the nested ones.
+// The machines may be gone already: the entries are compared, never used.
+struct Building {
+    char const *me;           // the machine
+    StateTbl const *tbl;      // the table of its class
+};
+static thread_local Building l_building[HSM_MAX_CLASSES + HSM_MAX_NESTED];
+static thread_local unsigned l_nBuilding;
+
+// find or create the state table of a machine class........................
+static StateTbl *stateTblOf_(EvtHndlr topHndlr) {
+    StateTbl *tbl;
+    for (tbl = l_stateTbl; tbl != &l_stateTbl[l_nStateTbls]; ++tbl) {
+        if (tbl->topHndlr == topHndlr) {
+            return tbl;
+        }
+    }
+    if (l_nStateTbls == HSM_MAX_CLASSES) {
+        tblFail_("more machine classes than HSM_MAX_CLASSES");
+    }
+    ++l_nStateTbls;
+    tbl->topHndlr = topHndlr;
+    tbl->n = 0;
+    return tbl;
+}
+
+// push a machine whose states are about to be constructed...................
+static void building_(Hsm *me, StateTbl const *tbl) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < l_nBuilding; ++i) {
+        if (l_building[i].tbl != tbl) { // another of the class is complete
+            l_building[n++] = l_building[i];
+        }
+    }
+    if (n == HSM_MAX_CLASSES + HSM_MAX_NESTED) {
+        tblFail_("machines nested deeper than HSM_MAX_NESTED");
+    }
+    l_building[n].me = (char const *)me;
+    l_building[n].tbl = tbl;
+    l_nBuilding = n + 1;
+}
+
+// find the machine of a superstate and drop the machines above it...........
+static Hsm *ownerOf_(State const *super, unsigned char id) {
+    for (unsigned i = l_nBuilding; i-- != 0; ) {
+        Building const *b = &l_building[i];
+        if (id < b->tbl->n
+            && (char const *)super - b->me == b->tbl->link[id].offset)
+        {
+            l_nBuilding = i + 1; // the machines above are complete
+            return (Hsm *)b->me;
+        }
+    }
+    tblFail_("superstate of a machine not being constructed");
+    return 0;
+}
+#endif
+
+// State Ctor (the superstate must be constructed first)......................
 State::State(char const *n, State *s, EvtHndlr h)
-  : super(s), hndlr(h), name(n)
-{}
+#ifdef HSM_STATE_TABLES
+  : id(0)
+#else
+  : super(s), hndlr(h), name(n), depth(s ? s->depth + 1 : 0), sub(0)
+#endif
+#ifdef HSM_PROFILE
+    , profId(s ? profState(n, s->profId) : PROF_NONE) // top: by the Hsm
+#endif
+{
+#ifdef HSM_STATE_TABLES
+    if (s != 0) { // the top is added by the Hsm ctor
+        stateLock_();
+        Hsm *me = ownerOf_(s, s->id);
+        stateUnlock_();
+        me->addState_(this, n, s, h);
+    }
+#else
+    assert(s == 0 || s->depth < 255); // depth must fit in unsigned char
+#endif
+#if defined(HSM_SIG_TABLES) && !defined(HSM_STATE_TABLES)
+    sigRow = 0; // given by the Hsm on the first use
+#endif
+}
 
 // Hsm Ctor...................................................................
 Hsm::Hsm(char const *n, EvtHndlr topHndlr)
-  : name(n), top("top", 0, topHndlr)
-{}
+  : curr(0), name(n), next(0), top("top", 0, topHndlr)
+#ifdef HSM_TRAN_TABLES
+    , tran(0)
+#endif
+    , exitHook(0), regions(0)
+#ifdef HSM_TRACE
+    , traceId(traceHsm(n)), traceEvt(0)
+#endif
+{
+#ifdef HSM_PROFILE
+    top.profId = profState(n, PROF_NONE); // the states under the machine name
+#endif
+#ifdef HSM_SIG_TABLES
+    stateLock_();
+    sigTbl = sigTblOf_(topHndlr);
+    stateUnlock_();
+#endif
+#ifdef HSM_STATE_TABLES
+    stateLock_();
+    stateTbl = stateTblOf_(topHndlr);
+    stateUnlock_();
+    addState_(&top, "top", 0, topHndlr);
+    building_(this, stateTbl); // for its states
+#endif
+}
 
-// enter and start the top state..............................................
-void Hsm::onStart() {
-    curr = &top;
-    next = 0;
-    curr->onEvent(this, &entryMsg);
-    while (curr->onEvent(this, &startMsg), next) {
-        State *entryPath[MAX_STATE_NESTING];
-        State **trace = entryPath;
-        State* s = next;
-        *trace = 0;
-        for (; s != curr; s = s->super) {
-            *(++trace) = s;  // trace path to target
+#ifdef HSM_STATE_TABLES
+// add a state to the table of the class or check it against the table......
+// The states of every instance get the same ids, so the table is shared.
+void Hsm::addState_(State *s, char const *n, State *super, EvtHndlr h) {
+    unsigned short offset = offsetOf_(s);
+    StateTbl *tbl = stateTbl;
+    stateLock_();
+    unsigned char id;
+    for (id = 0; id < tbl->n && tbl->link[id].offset != offset; ++id) {
+    }
+    if (id == tbl->n) { // a state not in the table yet?
+        if (tbl->n == HSM_MAX_STATES) {
+            tblFail_("more states of a class than HSM_MAX_STATES");
         }
-        while ((s = *trace--)) { // retrace entry from source
-            s->onEvent(this, &entryMsg);
+        if (super != 0 && tbl->link[super->id].depth == 255) {
+            tblFail_("states nested deeper than 255 levels");
         }
+        tbl->link[id].offset = offset;
+        tbl->link[id].super = (super != 0) ? super->id : 0;
+        tbl->link[id].depth = (super != 0) ? tbl->link[super->id].depth + 1
+                                           : 0;
+        tbl->hndlr[id] = h;
+        tbl->name[id] = n;
+        ++tbl->n;
+    }
+    else if (tbl->hndlr[id] != h
+             || tbl->link[id].super != ((super != 0) ? super->id : 0))
+    {
+        tblFail_("classes with one top handler and different states");
+    }
+    stateUnlock_();
+    s->id = id;
+}
+#endif
+
+// enter a single state.......................................................
+inline void Hsm::enterState_(State *s) {
+    HSM_TRACE_(TRACE_ENTRY, s, ENTRY_EVT);
+    HSM_PROF_BEGIN_();
+    call_(s, &entryMsg);
+    HSM_PROF_END_(s, PROF_ENTRY);
+}
+
+// enter the states below curr down to next, outermost first.................
+// The path is linked through State::sub (kept on the stack with the state
+// tables, where the depth is limited anyway), so it is not limited in length.
+inline void Hsm::enterPath_() {
+    State *s;
+#ifdef HSM_STATE_TABLES
+    State *path[256]; // the depth fits in unsigned char
+    unsigned n = 0;
+    for (s = next; s != curr; s = super_(s)) {
+        path[n++] = s; // trace path to target
+    }
+    while (n) { // retrace the entry
+        enterState_(path[--n]);
+    }
+#else
+    for (s = next; s != curr; s = s->super) {
+        s->super->sub = s; // trace path to target
+    }
+    for (s = curr; s != next; ) { // retrace the entry
+        s = s->sub;
+        enterState_(s);
+    }
+#endif
+}
+
+// start a state (take its initial transition, if any)........................
+inline void Hsm::startState_(State *s) {
+    HSM_PROF_BEGIN_();
+    call_(s, &startMsg);
+    if (next != 0) {
+        HSM_TRACE_(TRACE_INIT, s, START_EVT);
+        HSM_PROF_END_(s, PROF_INIT);
+    }
+}
+
+// exit a single state........................................................
+inline void Hsm::exitState_(State *s) {
+    HSM_TRACE_(TRACE_EXIT, s, EXIT_EVT);
+    if (regions != 0) {
+        stopRegions_(s); // the regions of an AND-state exit first
+    }
+    HSM_PROF_BEGIN_();
+    call_(s, &exitMsg);
+    HSM_PROF_END_(s, PROF_EXIT);
+    if (exitHook != 0) {
+        (*exitHook)(this, s);
+    }
+}
+
+// take the initial transitions from curr down..............................
+inline void Hsm::start_() {
+    while (startState_(curr), next) {
+        enterPath_();
         curr = next;
         next = 0;
     }
+    if (regions != 0) {
+        startRegions_(); // curr may be an AND-state
+    }
+}
+
+// enter and start the top state..............................................
+void Hsm::onStart() {
+    curr = &top;
+    next = 0;
+    enterState_(curr);
+    start_();
 }
 
 // state machine "engine".....................................................
-void Hsm::onEvent(Msg const *msg) {
-    State *entryPath[MAX_STATE_NESTING];
-    State **trace;
-    for (State *s = curr; s; s = s->super) {
+inline bool Hsm::dispatch_(Msg const *msg) {
+    if (regions != 0 && dispatchRegions_(msg)) {
+        return true; // consumed by the regions of the AND-state
+    }
+    return handle_(msg);
+}
+
+// pass the event up from the current state until a state consumes it.........
+inline bool Hsm::handle_(Msg const *msg) {
+    for (State *s = curr; s; s = super_(s)) {
+#ifdef HSM_SIG_TABLES
+        if (0 <= msg->evt && msg->evt < HSM_MAX_SIG) {
+            unsigned short h =
+                sigRow_(s)[msg->evt].load(std::memory_order_relaxed);
+            if (h == SIG_UNKNOWN) {
+                h = lookupSig_(s, msg->evt);
+            }
+            if (h == 0) { // no handler up to the top?
+                return false;
+            }
+            s = stateAt_(h); // skip the states that ignore the signal
+        }
+#endif
         source = s; // level of outermost event handler
-        msg = s->onEvent(this, msg);
+#ifdef HSM_TRACE
+        traceEvt = msg->evt;
+#endif
+        HSM_PROF_BEGIN_();
+        msg = call_(s, msg);
+        HSM_PROF_END_(s, (msg == 0) ? PROF_HANDLED : PROF_PASSED);
         if (msg == 0) { // processed?
             if (next) { // state transition taken?
-                trace = entryPath;
-                *trace = 0;
-                for (s = next; s != curr; s = s->super) {
-                    *(++trace) = s; // trace path to target
+#ifdef HSM_TRAN_TABLES
+                if (tran) { // compiled transition?
+                    unsigned short const *e = &tran->chain[tran->nExit];
+                    for (unsigned char n = tran->nEntry; n; --n) {
+                        enterState_(stateAt_(*e++));
+                    }
+                    tran = 0;
                 }
-                while ((s = *trace--)) { // retrace entry from LCA
-                    s->onEvent(this, &entryMsg);
+                else
+#endif
+                {
+                    enterPath_(); // enter from LCA
                 }
                 curr = next;
                 next = 0;
-                while (curr->onEvent(this, &startMsg), next) {
-                    trace = entryPath;
-                    *trace = 0;
-                    for (s = next; s != curr; s = s->super) {
-                        *(++trace) = s; // record path to target
-                    }
-                    while ((s = *trace--)) { // retrace the entry
-                        s->onEvent(this, &entryMsg);
-                    }
-                    curr = next;
-                    next = 0;
-                }
+                start_();
+            }
+            else { // internal transition
+                HSM_TRACE_(TRACE_DISPATCH, s, traceEvt);
+            }
+            return true; // event processed
+        }
+    }
+    return false;
+}
+
+// dispatch one event.........................................................
+void Hsm::onEvent(Msg const *msg) {
+    dispatch_(msg);
+}
+
+// dispatch a batch of events in one call.....................................
+// The regions are declared in the ctor, so they are checked once per batch.
+void Hsm::onEvents(Msg const * const *msgs, unsigned n) {
+    Msg const * const *end = msgs + n;
+    if (regions != 0) {
+        for (; msgs != end; ++msgs) {
+            dispatch_(*msgs);
+        }
+        return;
+    }
+    for (; msgs != end; ++msgs) {
+        handle_(*msgs);
+    }
+}
+
+// declare a region of an AND-state..........................................
+void Hsm::STATE_REGION(State *s, Region *r, RegionRunner *runner) {
+    r->state = s;
+    r->runner = runner;
+    r->nextRegion = 0;
+    Region **link = &regions;
+    while (*link != 0) {
+        assert(runner == 0 || (*link)->state != s || (*link)->runner == 0
+               || (*link)->runner == runner); // one runner per AND-state
+        link = &(*link)->nextRegion;
+    }
+    *link = r; // the regions run in the order of declaration
+}
+
+// dispatch to the regions of the current state, true if any consumed it.....
+bool Hsm::dispatchRegions_(Msg const *msg) {
+    Region *par[MAX_REGIONS];
+    unsigned nPar = 0;
+    bool consumed = false;
+    for (Region *r = regions; r != 0; r = r->nextRegion) {
+        if (r->state == curr) {
+            if (r->runner == 0) {
+                consumed |= r->dispatch_(msg);
             }
-            break; // event processed
+            else {
+                assert(nPar < MAX_REGIONS);
+                par[nPar++] = r;
+            }
+        }
+    }
+    if (nPar > 1) {
+        RegionRunner *runner = par[0]->runner;
+        consumed |= (*runner->run)(runner, par, nPar, msg);
+    }
+    else if (nPar == 1) {
+        consumed |= par[0]->dispatch_(msg);
+    }
+    return consumed;
+}
+
+// enter and start the regions of the current state..........................
+void Hsm::startRegions_() {
+    for (Region *r = regions; r != 0; r = r->nextRegion) {
+        if (r->state == curr) {
+            r->onStart();
+        }
+    }
+}
+
+// exit the regions of a state................................................
+void Hsm::stopRegions_(State *s) {
+    for (Region *r = regions; r != 0; r = r->nextRegion) {
+        if (r->state == s) {
+            r->stop_();
         }
     }
 }
 
+// exit the current state and all its superstates up to the top............
+void Hsm::stop_() {
+    for (State *s = curr; s != 0; s = super_(s)) {
+        exitState_(s);
+    }
+    curr = 0;
+}
+
+// exit all the states, with their regions and exit hooks...................
+void Hsm::onStop() {
+    stop_();
+}
+
+// Region Ctor................................................................
+Region::Region(char const *n, EvtHndlr topHndlr)
+  : Hsm(n, topHndlr), state(0), nextRegion(0), runner(0)
+{}
+
+// dispatch an event to the region (in the thread of a RegionRunner)..........
+bool Region::dispatch(Msg const *msg) {
+    return dispatch_(msg);
+}
+
+#ifdef HSM_SIG_TABLES
+// find the state handling a signal and cache it in the signal tables.........
+unsigned short Hsm::lookupSig_(State *s, Event sig) {
+    std::atomic<unsigned short> *row = sigRow_(s);
+    unsigned short h = row[sig].load(std::memory_order_relaxed);
+    if (h == SIG_UNKNOWN) {
+        State *super = super_(s);
+        h = (super != 0) ? lookupSig_(super, sig) : 0;
+        row[sig].store(h, std::memory_order_relaxed);
+    }
+    return h;
+}
+
+#ifndef HSM_STATE_TABLES
+// give a state the row of its offset in the signal tables of the class......
+std::atomic<unsigned short> *Hsm::newSigRow_(State *s) {
+    unsigned short offset = offsetOf_(s);
+    SigTbl *tbl = sigTbl;
+    stateLock_();
+    unsigned r;
+    for (r = 0; r < tbl->n && tbl->offset[r] != offset; ++r) {
+    }
+    if (r == tbl->n) { // the first instance uses the state?
+        if (tbl->n == HSM_MAX_STATES) {
+            tblFail_("more states of a class than HSM_MAX_STATES");
+        }
+        tbl->offset[r] = offset;
+        ++tbl->n;
+    }
+    stateUnlock_();
+    s->sigRow = tbl->row[r];
+    return s->sigRow;
+}
+#endif
+#endif
+
 // exit current states and all superstates up to LCA .........................
 void Hsm::exit_(unsigned char toLca) {
+    HSM_TRACE_(TRACE_TRAN, source, traceEvt);
     State *s = curr;
     while (s != source) {
-        s->onEvent(this, &exitMsg);
-        s = s->super;
+        exitState_(s);
+        s = super_(s);
     }
     while ((toLca--)) {
-        s->onEvent(this, &exitMsg);
-        s = s->super;
+        exitState_(s);
+        s = super_(s);
     }
     curr = s;
 }
 
+
 // find # of levels to Least Common Ancestor..................................
 unsigned char Hsm::toLCA_(State *target) {
     unsigned char toLca = 0;
     if (source == target) {
         return 1;
     }
-    for (State *s = source; s; ++toLca, s = s->super) {
-        for (State *t = target; t; t = t->super) {
-            if (s == t) {
-                return toLca;
-            }
-        }
+    State *s = source;
+    State *t = target;
+    for (; depth_(s) > depth_(t); s = super_(s)) {
+        ++toLca; // climb to the level of the target
     }
-    return 0;
+    while (depth_(t) > depth_(s)) {
+        t = super_(t); // climb to the level of the source
+    }
+    for (; s != t; s = super_(s), t = super_(t)) {
+        ++toLca;
+    }
+    return toLca;
+}
+
+// cache the Least Common Ancestor of the source and target.................
+Lca Hsm::findLca_(State *target) {
+    Lca lca;
+    lca.source = offsetOf_(source);
+    lca.target = offsetOf_(target);
+    lca.toLca = toLCA_(target);
+    return lca;
+}
+
+#ifdef HSM_TRAN_TABLES
+// take a compiled transition (exit states up to LCA)..........................
+void Hsm::tran_(Tran const *t, State *target) {
+    if (!isAt_(source, t->source) || !isAt_(target, t->target)) {
+        exit_(toLCA_(target)); // handler shared by another source state
+        next = target;
+        return;
+    }
+    HSM_TRACE_(TRACE_TRAN, source, traceEvt);
+    State *s = curr;
+    while (s != source) {
+        exitState_(s);
+        s = super_(s);
+    }
+    unsigned short const *e = t->chain;
+    for (unsigned char n = t->nExit; n; --n) {
+        exitState_(stateAt_(*e++));
+    }
+    curr = stateAt_(t->lca);
+    next = target;
+    tran = t;
+}
+
+// precompute the exit and entry chains of a transition.......................
+Tran Hsm::compile_(State *target) {
+    Tran t;
+    unsigned char toLca = toLCA_(target);
+    State *lca = source;
+    for (unsigned char n = toLca; n; --n) {
+        lca = super_(lca);
+    }
+    t.source = offsetOf_(source);
+    if (toLca > MAX_STATE_NESTING
+        || depth_(target) - depth_(lca) > MAX_STATE_NESTING)
+    {
+        t.target = 0; // too deep, never matches a target
+        return t;
+    }
+    State *s = source;
+    unsigned char n;
+    for (n = 0; n < toLca; ++n, s = super_(s)) {
+        t.chain[n] = offsetOf_(s);
+    }
+    t.nExit = n;
+    t.lca = offsetOf_(s);
+    n = depth_(target) - depth_(s); // # of states to enter
+    t.nEntry = n;
+    for (State *e = target; e != s; e = super_(e)) {
+        t.chain[t.nExit + --n] = offsetOf_(e); // outermost state first
+    }
+    t.target = offsetOf_(target);
+    return t;
 }
+#endif
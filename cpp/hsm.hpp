@@ -29,24 +29,138 @@
 #ifndef HSM_HPP_
 #define HSM_HPP_
 
+#include <stddef.h>
+
 typedef int Event;
 struct Msg {
     Event evt;
 };
 
 class Hsm; // forward declaration
+class State;
+class Region;
 typedef Msg const *(Hsm::*EvtHndlr)(Msg const *);
+typedef void (*ExitHook)(Hsm *me, State *s); // called after a state exits
+
+#ifndef MAX_STATE_NESTING
+#define MAX_STATE_NESTING 8 // max # of exits or entries of a compiled transition
+#endif
+
+#define HSM_MAX_OFFSET 0xFFFE // states within 64 KB of the Hsm (0xFFFF reserved)
+
+// Least Common Ancestor of one (source, target) pair, cached by STATE_TRAN().
+// The states are stored as their offsets within the Hsm object, so one cache
+// serves every instance of the state machine class. A state farther than
+// HSM_MAX_OFFSET from its Hsm aborts the program when its offset is stored.
+struct Lca {
+    unsigned short source;   // offset of the source state
+    unsigned short target;   // offset of the target state
+    unsigned char toLca;     // # of levels to exit above the source
+};
+
+#ifdef HSM_TRAN_TABLES
+// "compiled" transition: the exit and entry chains of one (source, target)
+// pair, precomputed on the first use of a STATE_TRAN(). The states are
+// stored as their offsets within the Hsm object, like in the Lca. A
+// transition with longer chains than MAX_STATE_NESTING is not compiled
+// (target 0) and is taken like without HSM_TRAN_TABLES.
+struct Tran {
+    unsigned short source;   // offset of the source state
+    unsigned short target;   // offset of the target state
+    unsigned short lca;      // offset of the Least Common Ancestor
+    unsigned char nExit;     // # of states to exit from the source up to LCA
+    unsigned char nEntry;    // # of states to enter from LCA down to target
+    unsigned short chain[2*MAX_STATE_NESTING]; // exits, then entries
+};
+#endif
+
+#ifndef MAX_REGIONS
+#define MAX_REGIONS 8       // max # of regions of one AND-state run in parallel
+#endif
+
+// Runs the event of independent regions in parallel (RegionPool in
+// region.hpp). The engine calls it through a pointer, so hsm.cpp does not
+// depend on threads. Returns true if any of the regions consumed the event.
+struct RegionRunner {
+    bool (*run)(RegionRunner *me, Region * const *r, unsigned n,
+                Msg const *msg);
+};
+
+#if defined(HSM_STATE_TABLES) || defined(HSM_SIG_TABLES)
+#ifndef HSM_MAX_STATES
+#define HSM_MAX_STATES 32   // max # of states of one machine class
+#endif
+#ifndef HSM_MAX_CLASSES
+#define HSM_MAX_CLASSES 16  // max # of machine classes (state tables)
+#endif
+#endif
+
+#ifdef HSM_SIG_TABLES
+#include <atomic>
+
+#ifndef HSM_MAX_SIG
+#define HSM_MAX_SIG 32      // signals 0..HSM_MAX_SIG-1 are looked up in tables
+#endif
+#define SIG_UNKNOWN 0xFFFF  // handler of the signal not looked up yet
+
+// The signal tables of the states of one machine class, shared by all its
+// instances. A row of a state holds the offset of the state handling each
+// signal: the state itself if it declared the signal with STATE_HANDLES(),
+// else the nearest superstate that did, or 0 if none, or SIG_UNKNOWN until
+// the first lookup. The rows are the state ids with HSM_STATE_TABLES, else
+// they are given to the states on their first use. All instances write
+// the same values, so the entries need only relaxed atomics.
+typedef std::atomic<unsigned short> SigRow[HSM_MAX_SIG];
+
+struct SigTbl {
+    SigRow row[HSM_MAX_STATES];
+    unsigned short offset[HSM_MAX_STATES]; // state of each row
+    EvtHndlr topHndlr;       // top handler of the machine class (the key)
+    unsigned n;              // # of rows given to the states
+};
+#endif
+
+#ifdef HSM_STATE_TABLES
+
+// The states of one machine class, shared by all its instances. The hot
+// fields walked by the engine are packed by state id in cache-line aligned
+// arrays: the links first, 16 states in a cache line, then the handlers,
+// 4 in a cache line. The names are only used by the tracing and the
+// snapshots and are kept apart. A State object is then only its id.
+struct StateLink {
+    unsigned short offset;   // offset of the state within the Hsm object
+    unsigned char super;     // id of the superstate (the top is 0)
+    unsigned char depth;     // nesting level (top is 0)
+};
+
+struct StateTbl {
+    alignas(64) StateLink link[HSM_MAX_STATES];
+    alignas(64) EvtHndlr hndlr[HSM_MAX_STATES];
+    alignas(64) char const *name[HSM_MAX_STATES]; // cold
+    EvtHndlr topHndlr;       // top handler of the machine class (the key)
+    unsigned char n;         // # of states
+};
+#endif
 
 class State {
+#ifdef HSM_STATE_TABLES
+    unsigned char id;        // index of the state in the StateTbl
+#else
     State *super;    // pointer to superstate
     EvtHndlr hndlr;  // state's handler function
     char const *name;
+    unsigned char depth; // nesting level (top is 0)
+    State *sub;      // substate on the path being entered (engine scratch)
+#endif
+#ifdef HSM_PROFILE
+    unsigned short profId; // id of the state in the profile (hsmprof.hpp)
+#endif
+#if defined(HSM_SIG_TABLES) && !defined(HSM_STATE_TABLES)
+    std::atomic<unsigned short> *sigRow; // in the SigTbl (0 until used)
+#endif
 public:
     State(char const *name, State *super, EvtHndlr hndlr);
 private:
-    Msg const *onEvent(Hsm *ctx, Msg const *msg) {
-        return (ctx->*hndlr)(msg);
-    }
     friend class Hsm;
 };
 
@@ -57,28 +171,162 @@ protected:
     State *next;      // next state (non 0 if transition taken)
     State *source;    // source state during last transition
     State top;        // top-most state object
+#ifdef HSM_TRAN_TABLES
+    Tran const *tran; // compiled transition taken (0 if none)
+#endif
+    ExitHook exitHook; // called after every state exit (or 0)
+    Region *regions;  // orthogonal regions of the AND-states (or 0)
+#ifdef HSM_STATE_TABLES
+    StateTbl *stateTbl; // states of the machine class
+#endif
+#ifdef HSM_SIG_TABLES
+    SigTbl *sigTbl;     // signals of the states of the machine class
+#endif
+#ifdef HSM_TRACE
+    unsigned traceId;       // id of the machine in the trace
+    Event traceEvt;         // event being dispatched
+#endif
 public:
     Hsm(char const *name, EvtHndlr topHndlr); // ctor
     void onStart();               // enter and start the top state
+    void onStop();                // exit all the states (can start again)
     void onEvent(Msg const *msg); // state machine "engine"
+    void onEvents(Msg const * const *msgs, unsigned n); // n events in a row
 protected:
     unsigned char toLCA_(State *target);
     void exit_(unsigned char toLca);
+    Lca findLca_(State *target);
+    unsigned char toLca_(Lca const *lca, State *target) {
+        return (isAt_(source, lca->source) && isAt_(target, lca->target))
+               ? lca->toLca
+               : toLCA_(target); // handler shared by another source state
+    }
+#ifdef HSM_TRAN_TABLES
+    Tran compile_(State *target);
+    void tran_(Tran const *t, State *target);
+#endif
+private:
+    bool dispatch_(Msg const *msg); // true if consumed
+    bool handle_(Msg const *msg);   // dispatch_() without the regions
+    bool dispatchRegions_(Msg const *msg);
+    void enterState_(State *s);
+    void enterPath_();
+    void startState_(State *s);
+    void start_();
+    void exitState_(State *s);
+    void stop_();                 // exit all the states of a region
+    void startRegions_();
+    void stopRegions_(State *s);
+#ifdef HSM_SIG_TABLES
+    unsigned short lookupSig_(State *s, Event sig);
+    std::atomic<unsigned short> *sigRow_(State *s) {
+#ifdef HSM_STATE_TABLES
+        return sigTbl->row[s->id];
+#else
+        return (s->sigRow != 0) ? s->sigRow : newSigRow_(s);
+#endif
+    }
+#ifndef HSM_STATE_TABLES
+    std::atomic<unsigned short> *newSigRow_(State *s);
+#endif
+#endif
+    unsigned short offsetOf_(State const *s) const { // to be stored
+        size_t offset = (size_t)((char const *)s - (char const *)this);
+        if (offset > HSM_MAX_OFFSET) {
+            offsetFail_(); // also without asserts
+        }
+        return (unsigned short)offset;
+    }
+    bool isAt_(State const *s, unsigned short offset) const { // not truncated
+        return (char const *)s - (char const *)this == (ptrdiff_t)offset;
+    }
+    static void offsetFail_();
+    State *stateAt_(unsigned short offset) {
+        return (State *)((char *)this + offset);
+    }
+#ifdef HSM_STATE_TABLES
+    void addState_(State *s, char const *n, State *super, EvtHndlr h);
+    Msg const *call_(State *s, Msg const *msg) {
+        return (this->*stateTbl->hndlr[s->id])(msg);
+    }
+    State *super_(State *s) {
+        return (s->id != 0)
+               ? stateAt_(stateTbl->link[stateTbl->link[s->id].super].offset)
+               : 0;
+    }
+    unsigned char depth_(State const *s) const {
+        return stateTbl->link[s->id].depth;
+    }
+    char const *name_(State const *s) const {
+        return stateTbl->name[s->id];
+    }
+#else
+    Msg const *call_(State *s, Msg const *msg) {
+        return (this->*s->hndlr)(msg);
+    }
+    static State *super_(State *s) { return s->super; }
+    static unsigned char depth_(State const *s) { return s->depth; }
+    static char const *name_(State const *s) { return s->name; }
+#endif
+    friend class HsmSnap;
+    friend class State;
+    friend class Region;
+protected:
     State *STATE_CURR() { return curr; }
     void STATE_START(State *target) {
         //assert(next == 0);
         next = target;
     }
+    // declare in the ctor a region of the AND-state s (a state without
+    // substates), independent regions with a runner are run in parallel
+    // (all by the same runner for one AND-state)
+    void STATE_REGION(State *s, Region *r, RegionRunner *runner = 0);
+    void STATE_HANDLES(State *s, Event sig) { // declare in the ctor
+#ifdef HSM_SIG_TABLES
+        if (0 <= sig && sig < HSM_MAX_SIG) {
+            sigRow_(s)[sig].store(offsetOf_(s), std::memory_order_relaxed);
+        }
+#else
+        (void)s;
+        (void)sig;
+#endif
+    }
+};
+
+// Region is an orthogonal region of an AND-state of its owner machine,
+// with its own states, handlers and current state. The owner enters and
+// starts its regions after it enters the AND-state, and exits them before
+// it exits the AND-state. An event in the AND-state goes to every region
+// first, and up from the AND-state only if no region consumed it.
+// Transitions in a region stay in the region.
+class Region : public Hsm {
+public:
+    Region(char const *name, EvtHndlr topHndlr); // ctor
+    bool dispatch(Msg const *msg); // for a RegionRunner, true if consumed
+private:
+    State *state;                 // AND-state of the owner
+    Region *nextRegion;           // next region of the owner
+    RegionRunner *runner;         // for running in parallel (or 0)
+    friend class Hsm;
 };
 
-# define STATE_TRAN(target_) do {       \
-    static unsigned char toLca_ = 0xFF; \
-    assert(next == 0);                  \
-    if (toLca_ == 0xFF)                 \
-        toLca_ = toLCA_(target_);       \
-    exit_(toLca_);                      \
-    next = (target_);                   \
+// The caches below are function-local statics initialized on the first
+// transition, which C++11 guarantees to be thread-safe. A cache built for
+// a different (source, target) pair is not used.
+#ifdef HSM_TRAN_TABLES
+# define STATE_TRAN(target_) do {                   \
+    static Tran const tbl_ = compile_(target_);     \
+    assert(next == 0);                              \
+    tran_(&tbl_, (target_));                        \
+} while (0)
+#else
+# define STATE_TRAN(target_) do {                   \
+    static Lca const lca_ = findLca_(target_);      \
+    assert(next == 0);                              \
+    exit_(toLca_(&lca_, (target_)));                \
+    next = (target_);                               \
 } while (0)
+#endif
 
 #define START_EVT ((Event)(-1))
 #define ENTRY_EVT ((Event)(-2))
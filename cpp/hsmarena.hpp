@@ -0,0 +1,113 @@
+//
+// hsmarena.hpp -- Arena of recycled state machines of one class
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMARENA_HPP_
+#define HSMARENA_HPP_
+
+#include "hsm.hpp"
+
+#include <assert.h>
+#include <new>
+
+// HsmArena hands out machines of the class T from a fixed array of slots
+// and takes them back in O(1), without any heap allocation. A returned
+// machine is stopped with onStop(), which runs the exit actions and exit
+// hooks of its states and stops its regions, but the slot keeps it
+// constructed, so a recycled machine is only restarted with onStart(): its
+// states, handlers and signal tables are not built again. T must be default-constructible and initialize its
+// extended state variables in the initial transition of its top state, or
+// they keep the values of the previous use. An arena is not thread-safe,
+// every thread creating machines uses an arena of its own.
+template<class T>
+class HsmArena {
+public:
+    struct Slot {
+        alignas(T) unsigned char obj[sizeof(T)]; // the machine (first)
+        Slot *next;                // next free slot
+        bool built;                // the machine is constructed
+    };
+    HsmArena() : nMin(0), sto(0), nSlots(0), freeList(0), nFree(0) {}
+    ~HsmArena() {                  // xtor, destroys the machines built
+        for (unsigned i = 0; i < nSlots; ++i) {
+            if (sto[i].built) {
+                machine_(&sto[i])->~T();
+            }
+        }
+    }
+    void init(Slot *s, unsigned n) { // provide the slots, all free
+        assert(sto == 0);
+        sto = s;
+        nSlots = n;
+        for (unsigned i = 0; i < n; ++i) {
+            s[i].next = (i + 1 < n) ? &s[i + 1] : 0;
+            s[i].built = false;
+        }
+        freeList = (n != 0) ? s : 0;
+        nFree = n;
+        nMin = n;
+    }
+    T *get() {                     // a started machine, 0 if none is free
+        Slot *s = freeList;
+        if (s == 0) {
+            return 0;
+        }
+        freeList = s->next;
+        if (--nFree < nMin) {
+            nMin = nFree;
+        }
+        T *me;
+        if (s->built) {
+            me = machine_(s);      // recycled, the states are there
+        }
+        else {
+            me = new (s->obj) T(); // the first use of the slot
+            s->built = true;
+        }
+        me->onStart();
+        return me;
+    }
+    void put(T *me) {              // stop and return a machine of the arena
+        Slot *s = reinterpret_cast<Slot *>(me);
+        assert(sto <= s && s < sto + nSlots && s->built);
+        me->onStop();
+        s->next = freeList;
+        freeList = s;
+        ++nFree;
+    }
+    unsigned nMin;                 // min # of free slots (low watermark)
+private:
+    static T *machine_(Slot *s) {
+        return std::launder(reinterpret_cast<T *>(s->obj));
+    }
+    Slot *sto;
+    unsigned nSlots;
+    Slot *freeList;
+    unsigned nFree;
+};
+
+#endif // HSMARENA_HPP_
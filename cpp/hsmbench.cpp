@@ -0,0 +1,392 @@
+//
+// hsmbench.cpp -- Hierarchical State Machine engine benchmark
+// Measures the cost of dispatching events handled in the current state and
+// in its superstates, of self- and cross-hierarchy transitions, and of
+// onStart() on a machine with two branches of 4 states, for the
+// Hsm engine (hsm.cpp) and the compile-time HsmT engine (hsmt.hpp).
+// Reports the best of BENCH_REPEAT runs in ns and TSC cycles per event.
+// The last case sends the events to BENCH_COLD machines in random order,
+// so the states walked are not in the cache.
+//
+// Build (add -DHSM_TRAN_TABLES to measure the compiled transitions,
+// -DHSM_SIG_TABLES to measure the signal tables, or -DHSM_STATE_TABLES
+// to measure the state tables):
+// g++ -O2 hsmbench.cpp hsm.cpp -o hsmbench
+//
+// usage: hsmbench [events-per-case]
+//
+#include "hsm.hpp"
+#include "hsmt.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ULL // no cycle counter, cycles reported as 0
+#endif
+
+#define BENCH_REPEAT 5      // # of runs of every case
+#define BENCH_BATCH  256    // # of events per onEvents() call
+#define BENCH_COLD   65536  // # of machines of the cache-cold case
+
+enum BenchEvents { // LEVELn_SIG is handled by the states at level n
+    LEVEL0_SIG, LEVEL1_SIG, LEVEL2_SIG, LEVEL3_SIG, LEVEL4_SIG,
+    SELF_SIG,      // self-transition of a leaf
+    CROSS_SIG      // transition to the other leaf
+};
+
+static Msg const benchMsg[] = {
+    { LEVEL0_SIG }, { LEVEL1_SIG }, { LEVEL2_SIG }, { LEVEL3_SIG },
+    { LEVEL4_SIG }, { SELF_SIG }, { CROSS_SIG }
+};
+
+// the benchmark machine on the Hsm engine....................................
+class Bench : public Hsm {
+protected:
+    State a1;         // top-a1-a2-a3-a4 branch
+      State a2;
+        State a3;
+          State a4;
+    State b1;         // top-b1-b2-b3-b4 branch
+      State b2;
+        State b3;
+          State b4;
+public:
+    unsigned long volatile nAct; // # of actions (not optimized away)
+    Bench();
+    bool isInLeaf() { return STATE_CURR() == &a4; }
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *a1Hndlr(Msg const *msg);
+    Msg const *a2Hndlr(Msg const *msg);
+    Msg const *a3Hndlr(Msg const *msg);
+    Msg const *a4Hndlr(Msg const *msg);
+    Msg const *b1Hndlr(Msg const *msg);
+    Msg const *b2Hndlr(Msg const *msg);
+    Msg const *b3Hndlr(Msg const *msg);
+    Msg const *b4Hndlr(Msg const *msg);
+private:
+    Msg const *level_(Msg const *msg, Event level) {
+        if (msg->evt == ENTRY_EVT || msg->evt == EXIT_EVT
+            || msg->evt == level)
+        {
+            ++nAct;
+            return 0;
+        }
+        return msg;
+    }
+};
+
+Msg const *Bench::topHndlr(Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(&a1);
+        return 0;
+    }
+    return level_(msg, LEVEL0_SIG);
+}
+
+Msg const *Bench::a1Hndlr(Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(&a2);
+        return 0;
+    }
+    return level_(msg, LEVEL1_SIG);
+}
+
+Msg const *Bench::a2Hndlr(Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(&a3);
+        return 0;
+    }
+    return level_(msg, LEVEL2_SIG);
+}
+
+Msg const *Bench::a3Hndlr(Msg const *msg) {
+    if (msg->evt == START_EVT) {
+        STATE_START(&a4);
+        return 0;
+    }
+    return level_(msg, LEVEL3_SIG);
+}
+
+Msg const *Bench::a4Hndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case SELF_SIG:
+        STATE_TRAN(&a4);
+        return 0;
+    case CROSS_SIG:
+        STATE_TRAN(&b4);
+        return 0;
+    }
+    return level_(msg, LEVEL4_SIG);
+}
+
+Msg const *Bench::b1Hndlr(Msg const *msg) {
+    return level_(msg, LEVEL1_SIG);
+}
+
+Msg const *Bench::b2Hndlr(Msg const *msg) {
+    return level_(msg, LEVEL2_SIG);
+}
+
+Msg const *Bench::b3Hndlr(Msg const *msg) {
+    return level_(msg, LEVEL3_SIG);
+}
+
+Msg const *Bench::b4Hndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case SELF_SIG:
+        STATE_TRAN(&b4);
+        return 0;
+    case CROSS_SIG:
+        STATE_TRAN(&a4);
+        return 0;
+    }
+    return level_(msg, LEVEL4_SIG);
+}
+
+Bench::Bench()
+: Hsm("Bench",      static_cast<EvtHndlr>(&Bench::topHndlr)),
+    a1("a1", &top,  static_cast<EvtHndlr>(&Bench::a1Hndlr)),
+    a2("a2", &a1,   static_cast<EvtHndlr>(&Bench::a2Hndlr)),
+    a3("a3", &a2,   static_cast<EvtHndlr>(&Bench::a3Hndlr)),
+    a4("a4", &a3,   static_cast<EvtHndlr>(&Bench::a4Hndlr)),
+    b1("b1", &top,  static_cast<EvtHndlr>(&Bench::b1Hndlr)),
+    b2("b2", &b1,   static_cast<EvtHndlr>(&Bench::b2Hndlr)),
+    b3("b3", &b2,   static_cast<EvtHndlr>(&Bench::b3Hndlr)),
+    b4("b4", &b3,   static_cast<EvtHndlr>(&Bench::b4Hndlr)),
+    nAct(0)
+{
+    STATE_HANDLES(&top, LEVEL0_SIG); // signals handled, for HSM_SIG_TABLES
+    STATE_HANDLES(&a1, LEVEL1_SIG);
+    STATE_HANDLES(&a2, LEVEL2_SIG);
+    STATE_HANDLES(&a3, LEVEL3_SIG);
+    STATE_HANDLES(&a4, LEVEL4_SIG);
+    STATE_HANDLES(&a4, SELF_SIG);
+    STATE_HANDLES(&a4, CROSS_SIG);
+    STATE_HANDLES(&b1, LEVEL1_SIG);
+    STATE_HANDLES(&b2, LEVEL2_SIG);
+    STATE_HANDLES(&b3, LEVEL3_SIG);
+    STATE_HANDLES(&b4, LEVEL4_SIG);
+    STATE_HANDLES(&b4, SELF_SIG);
+    STATE_HANDLES(&b4, CROSS_SIG);
+}
+
+// the same machine on the HsmT engine........................................
+struct A1 : SubstateOf<TopState> {};
+struct A2 :   SubstateOf<A1> {};
+struct A3 :     SubstateOf<A2> {};
+struct A4 :       SubstateOf<A3> {};
+struct B1 : SubstateOf<TopState> {};
+struct B2 :   SubstateOf<B1> {};
+struct B3 :     SubstateOf<B2> {};
+struct B4 :       SubstateOf<B3> {};
+
+class BenchT : public HsmT<BenchT> {
+public:
+    unsigned long volatile nAct; // # of actions (not optimized away)
+    BenchT() : HsmT<BenchT>("BenchT"), nAct(0) {}
+    template<class S>
+    Msg const *hndlr(S, Msg const *msg) { // B1, B2, B3
+        return level_(msg, S::depth);
+    }
+    Msg const *hndlr(TopState s, Msg const *msg) {
+        if (msg->evt == START_EVT) {
+            stateStart<A1>(s);
+            return 0;
+        }
+        return level_(msg, LEVEL0_SIG);
+    }
+    Msg const *hndlr(A1 s, Msg const *msg) {
+        if (msg->evt == START_EVT) {
+            stateStart<A2>(s);
+            return 0;
+        }
+        return level_(msg, LEVEL1_SIG);
+    }
+    Msg const *hndlr(A2 s, Msg const *msg) {
+        if (msg->evt == START_EVT) {
+            stateStart<A3>(s);
+            return 0;
+        }
+        return level_(msg, LEVEL2_SIG);
+    }
+    Msg const *hndlr(A3 s, Msg const *msg) {
+        if (msg->evt == START_EVT) {
+            stateStart<A4>(s);
+            return 0;
+        }
+        return level_(msg, LEVEL3_SIG);
+    }
+    Msg const *hndlr(A4 s, Msg const *msg) {
+        switch (msg->evt) {
+        case SELF_SIG:
+            stateTran<A4>(s);
+            return 0;
+        case CROSS_SIG:
+            stateTran<B4>(s);
+            return 0;
+        }
+        return level_(msg, LEVEL4_SIG);
+    }
+    Msg const *hndlr(B4 s, Msg const *msg) {
+        switch (msg->evt) {
+        case SELF_SIG:
+            stateTran<B4>(s);
+            return 0;
+        case CROSS_SIG:
+            stateTran<A4>(s);
+            return 0;
+        }
+        return level_(msg, LEVEL4_SIG);
+    }
+private:
+    Msg const *level_(Msg const *msg, Event level) {
+        if (msg->evt == ENTRY_EVT || msg->evt == EXIT_EVT
+            || msg->evt == level)
+        {
+            ++nAct;
+            return 0;
+        }
+        return msg;
+    }
+};
+
+// run one case n times (onStart() if msg is 0), print the best run..........
+template<class M>
+static void run(M *me, char const *name, Msg const *msg, unsigned long n) {
+    double bestNs = 0.0;
+    double bestCyc = 0.0;
+    for (int r = 0; r < BENCH_REPEAT; ++r) {
+        std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        unsigned long long c0 = BENCH_CYCLES();
+        if (msg == 0) {
+            for (unsigned long i = 0; i < n; ++i) {
+                me->onStart();
+            }
+        }
+        else {
+            for (unsigned long i = 0; i < n; ++i) {
+                me->onEvent(msg);
+            }
+        }
+        c0 = BENCH_CYCLES() - c0;
+        double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - t0).count();
+        if (r == 0 || ns < bestNs * n) {
+            bestNs = ns / n;
+            bestCyc = (double)c0 / n;
+        }
+    }
+    printf("%-34s %8.2f %10.1f\n", name, bestNs, bestCyc);
+}
+
+// run one case n times in batches of BENCH_BATCH events with onEvents()....
+static void runBatch(Hsm *me, char const *name, Msg const *msg,
+                     unsigned long n)
+{
+    Msg const *batch[BENCH_BATCH];
+    for (unsigned i = 0; i < BENCH_BATCH; ++i) {
+        batch[i] = msg;
+    }
+    double bestNs = 0.0;
+    double bestCyc = 0.0;
+    for (int r = 0; r < BENCH_REPEAT; ++r) {
+        std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        unsigned long long c0 = BENCH_CYCLES();
+        for (unsigned long i = 0; i < n; i += BENCH_BATCH) {
+            me->onEvents(batch, BENCH_BATCH);
+        }
+        c0 = BENCH_CYCLES() - c0;
+        double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - t0).count();
+        if (r == 0 || ns < bestNs * n) {
+            bestNs = ns / n;
+            bestCyc = (double)c0 / n;
+        }
+    }
+    printf("%-34s %8.2f %10.1f\n", name, bestNs, bestCyc);
+}
+
+// run one case n times on the machines in random order....................
+static void runCold(Bench *const *me, char const *name, Msg const *msg,
+                    unsigned long n)
+{
+    double bestNs = 0.0;
+    double bestCyc = 0.0;
+    unsigned rnd = 1;
+    for (int r = 0; r < BENCH_REPEAT; ++r) {
+        std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        unsigned long long c0 = BENCH_CYCLES();
+        for (unsigned long i = 0; i < n; ++i) {
+            rnd = rnd * 1103515245U + 12345U;
+            me[(rnd >> 8) % BENCH_COLD]->onEvent(msg);
+        }
+        c0 = BENCH_CYCLES() - c0;
+        double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - t0).count();
+        if (r == 0 || ns < bestNs * n) {
+            bestNs = ns / n;
+            bestCyc = (double)c0 / n;
+        }
+    }
+    printf("%-34s %8.2f %10.1f\n", name, bestNs, bestCyc);
+}
+
+template<class M>
+static void runAll(M *me, unsigned long n) {
+    printf("case                                ns/evt  cycles/evt\n");
+    run(me, "handled in the current state", &benchMsg[LEVEL4_SIG], n);
+    run(me, "handled 1 level up", &benchMsg[LEVEL3_SIG], n);
+    run(me, "handled 2 levels up", &benchMsg[LEVEL2_SIG], n);
+    run(me, "handled 4 levels up (top)", &benchMsg[LEVEL0_SIG], n);
+    run(me, "self-transition", &benchMsg[SELF_SIG], n);
+    run(me, "cross transition (4 exit, 4 entry)", &benchMsg[CROSS_SIG], n);
+    run(me, "onStart (5 entry, 4 init)", (Msg const *)0, n);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long n = (argc > 1) ? strtoul(argv[1], 0, 10) : 10000000UL;
+    static Bench bench;
+    static BenchT benchT;
+    bench.onStart();
+    assert(bench.isInLeaf());
+    benchT.onStart();
+
+    printf("Hsm engine"
+#ifdef HSM_TRAN_TABLES
+           " (HSM_TRAN_TABLES)"
+#endif
+#ifdef HSM_SIG_TABLES
+           " (HSM_SIG_TABLES)"
+#endif
+#ifdef HSM_STATE_TABLES
+           " (HSM_STATE_TABLES)"
+#endif
+           ", %lu events per case\n\n", n);
+    runAll(&bench, n);
+    runBatch(&bench, "current state, onEvents() batches",
+             &benchMsg[LEVEL4_SIG], n);
+
+    static Bench *cold[BENCH_COLD];
+    for (unsigned i = 0; i < BENCH_COLD; ++i) {
+        cold[i] = new Bench;
+        cold[i]->onStart();
+    }
+    runCold(cold, "4 levels up, cache-cold machines",
+            &benchMsg[LEVEL0_SIG], n / 10);
+    printf("(%u bytes per machine)\n", (unsigned)sizeof(Bench));
+    printf("\nHsmT engine, %lu events per case\n\n", n);
+    runAll(&benchT, n);
+    return 0;
+}
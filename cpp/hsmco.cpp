@@ -0,0 +1,92 @@
+//
+// hsmco.cpp -- Workers of the coroutine actions of active objects
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include "hsmco.hpp"
+
+// AoWorkers Ctor.............................................................
+AoWorkers::AoWorkers(unsigned n)
+  : threads(new std::thread[n]), nThreads(n), jobs(0), stopping(false)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        threads[i] = std::thread(&AoWorkers::work_, this);
+    }
+}
+
+// AoWorkers Xtor.............................................................
+AoWorkers::~AoWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cond.notify_all();
+    }
+    for (unsigned i = 0; i < nThreads; ++i) {
+        threads[i].join();
+    }
+    delete[] threads;
+}
+
+// run a job now..............................................................
+void AoWorkers::run(AoJob *job) {
+    runAt(job, std::chrono::steady_clock::time_point());
+}
+
+// run a job at the due time (jobs due at the same time in order)............
+void AoWorkers::runAt(AoJob *job, std::chrono::steady_clock::time_point due) {
+    std::lock_guard<std::mutex> lock(mutex);
+    job->due = due;
+    AoJob **link = &jobs;
+    while (*link != 0 && (*link)->due <= due) {
+        link = &(*link)->next;
+    }
+    job->next = *link;
+    *link = job;
+    cond.notify_all(); // also the worker waiting for a later job
+}
+
+// run the jobs when they are due.............................................
+void AoWorkers::work_() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (jobs == 0) {
+            if (stopping) {
+                return;
+            }
+            cond.wait(lock);
+        }
+        else if (jobs->due > std::chrono::steady_clock::now()) {
+            cond.wait_until(lock, jobs->due);
+        }
+        else {
+            AoJob *job = jobs;
+            jobs = job->next;
+            lock.unlock();
+            (*job->work)(job);
+            lock.lock();
+        }
+    }
+}
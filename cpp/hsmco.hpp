@@ -0,0 +1,162 @@
+//
+// hsmco.hpp -- Coroutine actions of active objects (C++20)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMCO_HPP_
+#define HSMCO_HPP_
+
+#include "active.hpp"
+
+#ifndef __cpp_impl_coroutine
+#error "hsmco.hpp requires C++20 coroutines (-std=c++20)"
+#else
+
+#include <assert.h>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+
+// AoTask is the return type of a coroutine action of an active object.
+// The coroutine is started by a handler and runs up to its first co_await,
+// then the handler returns and the active object dispatches other events.
+// When the awaited operation completes, the rest of the coroutine runs in
+// the thread of the active object between two run-to-completion steps,
+// and it posts its result to the machine as an event. It must not take
+// state transitions, it is not in a handler. The frame of the coroutine
+// is freed when it ends. An active object must not be stopped while any
+// of its coroutines waits.
+struct AoTask {
+    struct promise_type {
+        AoTask get_return_object() { return AoTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// AoJob is work for the AoWorkers, run in one of its threads when due.
+struct AoJob {
+    void (*work)(AoJob *me);
+    AoJob *next;                   // next job of the AoWorkers
+    std::chrono::steady_clock::time_point due;
+};
+
+// AoWorkers runs the blocking operations awaited by the coroutines in its
+// own threads, so they do not stall the active objects, and keeps the
+// timers of the coroutines, sorted by their due times.
+class AoWorkers {
+public:
+    AoWorkers(unsigned nThreads); // ctor, # of worker threads
+    ~AoWorkers();                 // xtor, runs all the jobs and joins
+    void run(AoJob *job);         // any thread, run the job now
+    void runAt(AoJob *job, std::chrono::steady_clock::time_point due);
+private:
+    void work_();                 // the worker thread routine
+    std::thread *threads;
+    unsigned nThreads;
+    std::mutex mutex;             // protects all the members below
+    std::condition_variable cond; // a job was added
+    AoJob *jobs;                  // jobs sorted by the due time
+    bool stopping;
+};
+
+// AoAwait is the base of the operations a coroutine can co_await: the
+// completion of the operation in any thread posts the awaiter itself to
+// the active object, which resumes the coroutine in its own thread.
+class AoAwait : public CallMsg {
+public:
+    bool await_ready() const noexcept { return false; }
+protected:
+    AoAwait(Active *a) : ao(a) {
+        evt = CALL_EVT;
+        call = &AoAwait::resume_;
+    }
+    void complete() {             // any thread, resume in the AO thread
+        while (!ao->post(this)) { // queue full? the coroutine must resume
+            std::this_thread::yield();
+        }
+    }
+    Active *ao;
+    std::coroutine_handle<> coro; // the coroutine waiting
+private:
+    static void resume_(CallMsg const *me) {
+        static_cast<AoAwait const *>(me)->coro.resume();
+    }
+};
+
+// co_await of a function run by the AoWorkers, gives its result......
+template<class F>
+class AoCall : public AoAwait, private AoJob {
+public:
+    AoCall(Active *a, AoWorkers *w, F f) : AoAwait(a), workers(w), fun(f) {
+        work = &AoCall::work_;
+    }
+    void await_suspend(std::coroutine_handle<> h) {
+        coro = h;
+        workers->run(this);
+    }
+    decltype(auto) await_resume() { return result; }
+private:
+    static void work_(AoJob *job) { // in a worker thread
+        AoCall *me = static_cast<AoCall *>(job);
+        me->result = me->fun();
+        me->complete();
+    }
+    AoWorkers *workers;
+    F fun;
+    decltype(fun()) result;
+};
+
+template<class F>
+AoCall<F> aoCall(Active *ao, AoWorkers *workers, F fun) {
+    return AoCall<F>(ao, workers, fun);
+}
+
+// co_await of a delay, the active object goes on dispatching events.......
+class AoDelay : public AoAwait, private AoJob {
+public:
+    AoDelay(Active *a, AoWorkers *w, std::chrono::steady_clock::duration d)
+      : AoAwait(a), workers(w), delay(d)
+    {
+        work = &AoDelay::work_;
+    }
+    void await_suspend(std::coroutine_handle<> h) {
+        coro = h;
+        workers->runAt(this, std::chrono::steady_clock::now() + delay);
+    }
+    void await_resume() {}
+private:
+    static void work_(AoJob *job) { // in a worker thread
+        static_cast<AoDelay *>(job)->complete();
+    }
+    AoWorkers *workers;
+    std::chrono::steady_clock::duration delay;
+};
+
+#endif // __cpp_impl_coroutine
+#endif // HSMCO_HPP_
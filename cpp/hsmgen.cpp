@@ -0,0 +1,664 @@
+//
+// hsmgen.cpp -- Generator of flat state machines from a description
+// Reads the states, transitions, guards and actions of a hierarchical
+// state machine and writes a C++ class derived from Hsm (or from Active
+// or Region) in which the hierarchy is flattened: one dense table maps
+// every (state, signal) to the code of the transition, with the guards
+// of the state and its superstates in order and the exits, entries and
+// initial transitions precomputed. The engine runs the whole machine as
+// its top state, so no event bubbles up and no LCA is searched.
+//
+// Description, one item per line, # starts a comment:
+//   machine <class> [<base>]      the class (the base is Hsm by default)
+//   include <header>              #include "<header>" in the class header
+//                                 (or #include <header> given as <...>)
+//   signals <sig> ...             the signals 0, 1, 2, ... (enumerators)
+//   member <type> <name> = <value> extended state variable
+//   state <name> [<super>]        the first state is the top state
+//     entry <code>                entry action of the state
+//     exit <code>                 exit action of the state
+//     init <target> [<code>]      initial transition (code before entry)
+//     on <sig> [[<guard>]] [-> <target>] [<code>]
+// The code of an "on" runs before the exits of its transition, like the
+// code before STATE_TRAN() in a handler. A failing guard tries the next
+// "on" of the signal, then the superstates.
+//
+// Build:
+// g++ hsmgen.cpp -o hsmgen
+//
+// usage: hsmgen description output   (writes output.hpp and output.cpp)
+//
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GEN_MAX_STATES 256
+#define GEN_MAX_SIGS   256
+#define GEN_MAX_ONS    4096
+#define GEN_MAX_LINE   1024
+#define GEN_MAX_MEMBERS 64
+#define GEN_MAX_INCLUDES 16
+
+struct GenState {
+    char *name;
+    char *superName;        // until resolved
+    int super;              // index of the superstate (-1 for top)
+    int depth;
+    char *entry;            // entry code (or 0)
+    char *exit;             // exit code (or 0)
+    char *initName;         // until resolved
+    int init;               // initial target (-1 for none)
+    char *initCode;         // initial transition code (or 0)
+};
+
+struct GenOn {              // one "on" of a state
+    int state;
+    int sig;
+    char *guard;            // (or 0)
+    char *targetName;       // until resolved (or 0)
+    int target;             // (-1 for an internal transition)
+    char *code;             // (or 0)
+};
+
+struct Buf {                // growing text
+    char *str;
+    unsigned len, size;
+};
+
+static GenState l_state[GEN_MAX_STATES];
+static unsigned l_nStates;
+static GenOn l_on[GEN_MAX_ONS];
+static unsigned l_nOns;
+static char *l_sig[GEN_MAX_SIGS];
+static unsigned l_nSigs;
+static char *l_member[GEN_MAX_MEMBERS]; // "type name"
+static char *l_memberInit[GEN_MAX_MEMBERS];
+static unsigned l_nMembers;
+static char *l_include[GEN_MAX_INCLUDES];
+static unsigned l_nIncludes;
+static char *l_class;
+static char const *l_base = "Hsm";
+static char const *l_file;  // description being read
+static unsigned l_line;
+
+// report an error in the description and exit................................
+static void error_(char const *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    if (l_line != 0) {
+        fprintf(stderr, "%s:%u: ", l_file, l_line);
+    }
+    else {
+        fprintf(stderr, "%s: ", l_file);
+    }
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(1);
+}
+
+static char *dup_(char const *s, unsigned len) {
+    char *d = new char[len + 1];
+    memcpy(d, s, len);
+    d[len] = '\0';
+    return d;
+}
+
+// append formatted text to a buffer..........................................
+static void put_(Buf *b, char const *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(0, 0, fmt, ap);
+    va_end(ap);
+    if (b->len + n + 1 > b->size) {
+        unsigned size = (b->size == 0) ? 256 : b->size;
+        while (b->len + n + 1 > size) {
+            size *= 2;
+        }
+        char *str = new char[size];
+        if (b->str != 0) {
+            memcpy(str, b->str, b->len + 1);
+            delete[] b->str;
+        }
+        b->str = str;
+        b->size = size;
+    }
+    va_start(ap, fmt);
+    vsnprintf(b->str + b->len, n + 1, fmt, ap);
+    va_end(ap);
+    b->len += n;
+}
+
+// next word of the line (advances the line), 0 at the end....................
+static char *word_(char **line) {
+    char *s = *line;
+    while (isspace((unsigned char)*s)) {
+        ++s;
+    }
+    if (*s == '\0') {
+        *line = s;
+        return 0;
+    }
+    char *w = s;
+    while (*s != '\0' && !isspace((unsigned char)*s)) {
+        ++s;
+    }
+    char *r = dup_(w, (unsigned)(s - w));
+    *line = s;
+    return r;
+}
+
+// rest of the line without the leading and trailing blanks (or 0)...........
+static char *rest_(char *line) {
+    while (isspace((unsigned char)*line)) {
+        ++line;
+    }
+    unsigned len = (unsigned)strlen(line);
+    while (len != 0 && isspace((unsigned char)line[len - 1])) {
+        --len;
+    }
+    return (len != 0) ? dup_(line, len) : 0;
+}
+
+static int findState_(char const *name) {
+    for (unsigned i = 0; i < l_nStates; ++i) {
+        if (strcmp(l_state[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int findSig_(char const *name) {
+    for (unsigned i = 0; i < l_nSigs; ++i) {
+        if (strcmp(l_sig[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// parse an "on" line: <sig> [[<guard>]] [-> <target>] [<code>]..............
+static void parseOn_(char *line) {
+    if (l_nStates == 0) {
+        error_("\"on\" outside of a state");
+    }
+    if (l_nOns == GEN_MAX_ONS) {
+        error_("too many \"on\"");
+    }
+    GenOn *on = &l_on[l_nOns++];
+    on->state = (int)l_nStates - 1;
+    char *sig = word_(&line);
+    if (sig == 0 || (on->sig = findSig_(sig)) < 0) {
+        error_("unknown signal %s", sig != 0 ? sig : "");
+    }
+    on->guard = 0;
+    on->targetName = 0;
+    on->target = -1;
+    while (isspace((unsigned char)*line)) {
+        ++line;
+    }
+    if (*line == '[') { // guard up to the matching ]
+        unsigned depth = 0;
+        char *g = line;
+        for (; *line != '\0'; ++line) {
+            if (*line == '[') {
+                ++depth;
+            }
+            else if (*line == ']' && --depth == 0) {
+                break;
+            }
+        }
+        if (*line != ']') {
+            error_("missing ] of the guard");
+        }
+        on->guard = dup_(g + 1, (unsigned)(line - g - 1));
+        ++line;
+        while (isspace((unsigned char)*line)) {
+            ++line;
+        }
+    }
+    if (line[0] == '-' && line[1] == '>') {
+        line += 2;
+        on->targetName = word_(&line);
+        if (on->targetName == 0) {
+            error_("missing target state");
+        }
+    }
+    on->code = rest_(line);
+}
+
+// read the description.......................................................
+static void parse_(FILE *f) {
+    char buf[GEN_MAX_LINE];
+    while (fgets(buf, sizeof(buf), f) != 0) {
+        ++l_line;
+        char *hash = strchr(buf, '#');
+        if (hash != 0 && (hash == buf || isspace((unsigned char)hash[-1]))) {
+            *hash = '\0'; // a comment (not a # in the code)
+        }
+        char *line = buf;
+        char *kw = word_(&line);
+        if (kw == 0) {
+            continue;
+        }
+        if (strcmp(kw, "machine") == 0) {
+            l_class = word_(&line);
+            char *base = word_(&line);
+            if (base != 0) {
+                l_base = base;
+            }
+        }
+        else if (strcmp(kw, "include") == 0) {
+            if (l_nIncludes == GEN_MAX_INCLUDES) {
+                error_("too many includes");
+            }
+            l_include[l_nIncludes++] = word_(&line);
+        }
+        else if (strcmp(kw, "signals") == 0) {
+            for (char *s; (s = word_(&line)) != 0; ) {
+                if (l_nSigs == GEN_MAX_SIGS) {
+                    error_("too many signals");
+                }
+                l_sig[l_nSigs++] = s;
+            }
+        }
+        else if (strcmp(kw, "member") == 0) {
+            char *eq = strchr(line, '=');
+            if (eq == 0) {
+                error_("member without an initial value");
+            }
+            *eq = '\0';
+            if (l_nMembers == GEN_MAX_MEMBERS) {
+                error_("too many members");
+            }
+            l_member[l_nMembers] = rest_(line);
+            l_memberInit[l_nMembers++] = rest_(eq + 1);
+        }
+        else if (strcmp(kw, "state") == 0) {
+            if (l_nStates == GEN_MAX_STATES) {
+                error_("too many states");
+            }
+            GenState *s = &l_state[l_nStates];
+            s->name = word_(&line);
+            if (s->name == 0 || findState_(s->name) >= 0) {
+                error_("missing or repeated state name");
+            }
+            s->superName = word_(&line);
+            if ((s->superName == 0) != (l_nStates == 0)) {
+                error_("only the first state is the top state");
+            }
+            s->entry = 0;
+            s->exit = 0;
+            s->initName = 0;
+            s->init = -1;
+            s->initCode = 0;
+            ++l_nStates;
+        }
+        else if (l_nStates == 0) {
+            error_("%s outside of a state", kw);
+        }
+        else if (strcmp(kw, "entry") == 0) {
+            l_state[l_nStates - 1].entry = rest_(line);
+        }
+        else if (strcmp(kw, "exit") == 0) {
+            l_state[l_nStates - 1].exit = rest_(line);
+        }
+        else if (strcmp(kw, "init") == 0) {
+            l_state[l_nStates - 1].initName = word_(&line);
+            l_state[l_nStates - 1].initCode = rest_(line);
+        }
+        else if (strcmp(kw, "on") == 0) {
+            parseOn_(line);
+        }
+        else {
+            error_("unknown keyword %s", kw);
+        }
+    }
+    if (l_class == 0 || l_nStates == 0) {
+        error_("no machine or no states");
+    }
+}
+
+// resolve the state names and check the hierarchy............................
+static void resolve_() {
+    l_line = 0; // the errors below refer to the whole description
+    for (unsigned i = 0; i < l_nStates; ++i) {
+        GenState *s = &l_state[i];
+        s->super = (s->superName != 0) ? findState_(s->superName) : -1;
+        if (s->superName != 0 && (s->super < 0 || s->super >= (int)i)) {
+            error_("superstate %s of %s not declared before",
+                   s->superName, s->name);
+        }
+        s->depth = (s->super >= 0) ? l_state[s->super].depth + 1 : 0;
+    }
+    for (unsigned i = 0; i < l_nStates; ++i) {
+        GenState *s = &l_state[i];
+        if (s->initName != 0) {
+            s->init = findState_(s->initName);
+            int t = s->init;
+            while (t >= 0 && t != (int)i) {
+                t = l_state[t].super;
+            }
+            if (s->init < 0 || s->init == (int)i || t < 0) {
+                error_("initial target %s of %s not a substate",
+                       s->initName, s->name);
+            }
+        }
+    }
+    for (unsigned i = 0; i < l_nOns; ++i) {
+        if (l_on[i].targetName != 0
+            && (l_on[i].target = findState_(l_on[i].targetName)) < 0)
+        {
+            error_("unknown target state %s", l_on[i].targetName);
+        }
+    }
+}
+
+// # of levels to exit above the source, as Hsm::toLCA_()...................
+static unsigned toLca_(int source, int target) {
+    if (source == target) {
+        return 1;
+    }
+    unsigned toLca = 0;
+    int s = source;
+    int t = target;
+    for (; l_state[s].depth > l_state[t].depth; s = l_state[s].super) {
+        ++toLca;
+    }
+    while (l_state[t].depth > l_state[s].depth) {
+        t = l_state[t].super;
+    }
+    for (; s != t; s = l_state[s].super, t = l_state[t].super) {
+        ++toLca;
+    }
+    return toLca;
+}
+
+// enter the states below from down to to, outermost first...................
+static void putEntries_(Buf *b, int from, int to, char const *indent) {
+    int path[GEN_MAX_STATES];
+    unsigned n = 0;
+    for (int s = to; s != from; s = l_state[s].super) {
+        path[n++] = s;
+    }
+    while (n != 0) {
+        int s = path[--n];
+        if (l_state[s].entry != 0) {
+            put_(b, "%s%sEntry_();\n", indent, l_state[s].name);
+        }
+    }
+}
+
+// enter the states down to the target and take the initial transitions......
+// returns the state the machine ends in
+static int putEnter_(Buf *b, int from, int target, char const *indent) {
+    putEntries_(b, from, target, indent);
+    int s = target;
+    while (l_state[s].init >= 0) {
+        if (l_state[s].initCode != 0) {
+            put_(b, "%s%s\n", indent, l_state[s].initCode);
+        }
+        putEntries_(b, s, l_state[s].init, indent);
+        s = l_state[s].init;
+    }
+    return s;
+}
+
+// the code of a transition from the state curr by an "on" of source........
+static void putTran_(Buf *b, int curr, GenOn const *on, char const *indent) {
+    if (on->code != 0) {
+        put_(b, "%s%s\n", indent, on->code);
+    }
+    if (on->target >= 0) {
+        int s = curr;
+        for (; s != on->state; s = l_state[s].super) {
+            if (l_state[s].exit != 0) {
+                put_(b, "%s%sExit_();\n", indent, l_state[s].name);
+            }
+        }
+        for (unsigned n = toLca_(on->state, on->target); n != 0; --n) {
+            if (l_state[s].exit != 0) {
+                put_(b, "%s%sExit_();\n", indent, l_state[s].name);
+            }
+            s = l_state[s].super;
+        }
+        int end = putEnter_(b, s, on->target, indent);
+        put_(b, "%scurrId = %u; // %s\n", indent, (unsigned)end,
+             l_state[end].name);
+    }
+    put_(b, "%sreturn 0;\n", indent);
+}
+
+// the code of the signal in the state curr, false if no state handles it....
+static bool putCase_(Buf *b, int curr, int sig) {
+    for (int s = curr; s >= 0; s = l_state[s].super) {
+        for (unsigned i = 0; i < l_nOns; ++i) {
+            GenOn const *on = &l_on[i];
+            if (on->state != s || on->sig != sig) {
+                continue;
+            }
+            if (on->guard != 0) {
+                put_(b, "        if (%s) {\n", on->guard);
+                putTran_(b, curr, on, "            ");
+                put_(b, "        }\n");
+            }
+            else {
+                putTran_(b, curr, on, "        ");
+                return true;
+            }
+        }
+    }
+    if (b->len == 0) {
+        return false;
+    }
+    put_(b, "        break;\n"); // all guards failed
+    return true;
+}
+
+static FILE *create_(char const *out, char const *ext) {
+    char path[GEN_MAX_LINE];
+    snprintf(path, sizeof(path), "%s%s", out, ext);
+    FILE *f = fopen(path, "w");
+    if (f == 0) {
+        perror(path);
+        exit(1);
+    }
+    return f;
+}
+
+// file name without the directories..........................................
+static char const *baseName_(char const *path) {
+    char const *s = strrchr(path, '/');
+    char const *bs = strrchr(path, '\\');
+    if (bs != 0 && (s == 0 || bs > s)) {
+        s = bs;
+    }
+    return (s != 0) ? s + 1 : path;
+}
+
+// write the class header.....................................................
+static void writeHpp_(FILE *f, char const *out, char const *desc) {
+    char guard[GEN_MAX_LINE];
+    unsigned n = 0;
+    for (char const *s = baseName_(out); *s != '\0' && n + 6 < sizeof(guard);
+         ++s)
+    {
+        guard[n++] = isalnum((unsigned char)*s)
+                     ? (char)toupper((unsigned char)*s) : '_';
+    }
+    strcpy(&guard[n], "_HPP_");
+    fprintf(f, "//\n// %s.hpp -- generated by hsmgen from %s, do not edit\n"
+               "//\n#ifndef %s\n#define %s\n\n#include \"hsm.hpp\"\n",
+            baseName_(out), baseName_(desc), guard, guard);
+    for (unsigned i = 0; i < l_nIncludes; ++i) {
+        fprintf(f, (l_include[i][0] == '<') ? "#include %s\n"
+                                            : "#include \"%s\"\n",
+                l_include[i]);
+    }
+    fprintf(f, "\nclass %s : public %s {\n", l_class, l_base);
+    for (unsigned i = 0; i < l_nMembers; ++i) {
+        fprintf(f, "    %s;\n", l_member[i]);
+    }
+    fprintf(f, "    unsigned char currId; // current state\n"
+               "public:\n"
+               "    enum { N_STATES = %u, N_SIGS = %u };\n"
+               "    static char const * const stateName[N_STATES];\n"
+               "    %s();\n"
+               "    Msg const *topHndlr(Msg const *msg); // the whole machine\n"
+               "    unsigned stateOf() const { return currId; }\n"
+               "private:\n",
+            l_nStates, l_nSigs, l_class);
+    for (unsigned i = 0; i < l_nStates; ++i) {
+        if (l_state[i].entry != 0) {
+            fprintf(f, "    void %sEntry_();\n", l_state[i].name);
+        }
+        if (l_state[i].exit != 0) {
+            fprintf(f, "    void %sExit_();\n", l_state[i].name);
+        }
+    }
+    fprintf(f, "};\n\n#endif // %s\n", guard);
+}
+
+// write the class implementation.............................................
+static void writeCpp_(FILE *f, char const *out, char const *desc) {
+    fprintf(f, "//\n// %s.cpp -- generated by hsmgen from %s, do not edit\n"
+               "//\n#include \"%s.hpp\"\n\n",
+            baseName_(out), baseName_(desc), baseName_(out));
+    if (l_nSigs != 0) { // the signals index the table
+        fprintf(f, "static_assert(");
+        for (unsigned i = 0; i < l_nSigs; ++i) {
+            fprintf(f, "%s%s == %u", (i != 0) ? "\n              && " : "",
+                    l_sig[i], i);
+        }
+        fprintf(f, ",\n              \"signals 0, 1, 2, ... in the order of "
+                   "the description\");\n\n");
+    }
+
+    // the code of every (state, signal), the same code only once
+    Buf *code = new Buf[l_nStates * l_nSigs + 1];
+    unsigned *act = new unsigned[l_nStates * l_nSigs + 1];
+    unsigned nCode = 0;
+    for (unsigned s = 0; s < l_nStates; ++s) {
+        for (unsigned g = 0; g < l_nSigs; ++g) {
+            Buf b = { 0, 0, 0 };
+            unsigned a = 0;
+            if (putCase_(&b, (int)s, (int)g)) {
+                for (a = 1; a <= nCode; ++a) {
+                    if (strcmp(code[a - 1].str, b.str) == 0) {
+                        break;
+                    }
+                }
+                if (a > nCode) {
+                    code[nCode++] = b;
+                    fprintf(f, "// case %u: %s-%s\n", a, l_state[s].name,
+                            l_sig[g]);
+                }
+                else {
+                    delete[] b.str;
+                }
+            }
+            act[s * l_nSigs + g] = a;
+        }
+    }
+    char const *type = (nCode < 0x100) ? "unsigned char" : "unsigned short";
+    fprintf(f, "\n// the case of the code of every state and signal (0 if none)\n"
+               "static %s const l_tbl[%u][%u] = {\n",
+            type, l_nStates, (l_nSigs != 0) ? l_nSigs : 1);
+    for (unsigned s = 0; s < l_nStates; ++s) {
+        fprintf(f, "    {");
+        for (unsigned g = 0; g < l_nSigs; ++g) {
+            fprintf(f, "%s%u", (g != 0) ? ", " : " ", act[s * l_nSigs + g]);
+        }
+        fprintf(f, "%s }%s // %s\n", (l_nSigs != 0) ? "" : " 0",
+                (s + 1 < l_nStates) ? "," : "", l_state[s].name);
+    }
+    fprintf(f, "};\n\nchar const * const %s::stateName[N_STATES] = {\n",
+            l_class);
+    for (unsigned s = 0; s < l_nStates; ++s) {
+        fprintf(f, "    \"%s\"%s\n", l_state[s].name,
+                (s + 1 < l_nStates) ? "," : "");
+    }
+    fprintf(f, "};\n\n");
+
+    for (unsigned s = 0; s < l_nStates; ++s) {
+        if (l_state[s].entry != 0) {
+            fprintf(f, "void %s::%sEntry_() {\n    %s\n}\n\n",
+                    l_class, l_state[s].name, l_state[s].entry);
+        }
+        if (l_state[s].exit != 0) {
+            fprintf(f, "void %s::%sExit_() {\n    %s\n}\n\n",
+                    l_class, l_state[s].name, l_state[s].exit);
+        }
+    }
+
+    fprintf(f, "Msg const *%s::topHndlr(Msg const *msg) {\n"
+               "    switch (msg->evt) {\n"
+               "    case START_EVT:\n", l_class);
+    Buf b = { 0, 0, 0 };
+    int end = putEnter_(&b, 0, 0, "        ");
+    fprintf(f, "%s        currId = %u; // %s\n        return 0;\n",
+            (b.str != 0) ? b.str : "", (unsigned)end, l_state[end].name);
+    fprintf(f, "    case ENTRY_EVT:\n%s        return 0;\n",
+            (l_state[0].entry != 0) ? "        topEntry_();\n" : "");
+    fprintf(f, "    case EXIT_EVT:\n%s        return 0;\n    }\n",
+            (l_state[0].exit != 0) ? "        topExit_();\n" : "");
+    fprintf(f, "    if ((unsigned)msg->evt >= N_SIGS) {\n"
+               "        return msg;\n"
+               "    }\n"
+               "    switch (l_tbl[currId][msg->evt]) {\n");
+    for (unsigned a = 1; a <= nCode; ++a) {
+        fprintf(f, "    case %u:\n%s", a, code[a - 1].str);
+    }
+    fprintf(f, "    }\n    return msg;\n}\n\n");
+
+    fprintf(f, "%s::%s()\n  : %s(\"%s\", static_cast<EvtHndlr>(&%s::topHndlr))",
+            l_class, l_class, l_base, l_class, l_class);
+    for (unsigned i = 0; i < l_nMembers; ++i) {
+        char const *name = strrchr(l_member[i], ' ');
+        name = (name != 0) ? name + 1 : l_member[i];
+        while (*name == '*' || *name == '&') {
+            ++name;
+        }
+        fprintf(f, ",\n    %s(%s)", name, l_memberInit[i]);
+    }
+    fprintf(f, ",\n    currId(0)\n{\n");
+    for (unsigned g = 0; g < l_nSigs; ++g) { // for HSM_SIG_TABLES
+        fprintf(f, "    STATE_HANDLES(&top, %s);\n", l_sig[g]);
+    }
+    fprintf(f, "}\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: hsmgen description output\n");
+        return 2;
+    }
+    l_file = argv[1];
+    FILE *f = fopen(argv[1], "r");
+    if (f == 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    parse_(f);
+    fclose(f);
+    resolve_();
+    if (strcmp(l_state[0].name, "top") != 0) {
+        error_("the top state must be named top");
+    }
+    f = create_(argv[2], ".hpp");
+    writeHpp_(f, argv[2], argv[1]);
+    if (fclose(f) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    f = create_(argv[2], ".cpp");
+    writeCpp_(f, argv[2], argv[1]);
+    if (fclose(f) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    return 0;
+}
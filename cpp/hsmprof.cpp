@@ -0,0 +1,198 @@
+//
+// hsmprof.cpp -- Per-state profiling counters of the Hsm engine (HSM_PROFILE)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hsmprof.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PROF_TIME() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROF_TIME() __rdtsc()
+#else
+#define PROF_TIME() ((unsigned long long) \
+    std::chrono::duration_cast<std::chrono::nanoseconds>( \
+        std::chrono::steady_clock::now().time_since_epoch()).count())
+#endif
+
+struct ProfCell {           // counters of one state in one thread
+    alignas(64) std::atomic<unsigned long long> ctr[PROF_INIT + 1];
+    std::atomic<unsigned long long> cycles;
+};
+
+struct ProfArray {          // counters of one thread
+    ProfCell cell[HSM_PROF_MAX_STATES];
+    unsigned long long nested; // time of the measured calls (self time)
+    ProfArray *next;        // next array in l_arrays
+};
+
+struct ProfState {          // distinct profiled state
+    char const *name;
+    unsigned short super;   // id of the superstate (or PROF_NONE)
+};
+
+// The arrays are never freed, so the counts of the threads that have
+// ended are still summed.
+static std::atomic<ProfArray *> l_arrays;    // all arrays, newest first
+static thread_local ProfArray *l_array;      // array of the current thread
+static ProfState l_state[HSM_PROF_MAX_STATES];
+static std::atomic<unsigned> l_nStates;      // # of states in l_state
+static std::mutex l_mutex;                   // protects adding states
+
+// create and register the array of the current thread.......................
+static ProfArray *newArray_() {
+    ProfArray *a = new ProfArray;
+    for (unsigned i = 0; i < HSM_PROF_MAX_STATES; ++i) {
+        for (unsigned k = 0; k <= PROF_INIT; ++k) {
+            a->cell[i].ctr[k].store(0, std::memory_order_relaxed);
+        }
+        a->cell[i].cycles.store(0, std::memory_order_relaxed);
+    }
+    a->nested = 0;
+    a->next = l_arrays.load(std::memory_order_relaxed);
+    while (!l_arrays.compare_exchange_weak(a->next, a,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+    {}
+    l_array = a;
+    return a;
+}
+
+// id of a state with the name in the superstate, added if new...............
+unsigned short profState(char const *name, unsigned short super) {
+    std::lock_guard<std::mutex> lock(l_mutex);
+    unsigned n = l_nStates.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < n; ++i) {
+        if (l_state[i].super == super && strcmp(l_state[i].name, name) == 0) {
+            return (unsigned short)i;
+        }
+    }
+    if (n == HSM_PROF_MAX_STATES) { // also without asserts
+        fprintf(stderr, "hsmprof: more states than HSM_PROF_MAX_STATES\n");
+        abort();
+    }
+    l_state[n].name = name;
+    l_state[n].super = super;
+    l_nStates.store(n + 1, std::memory_order_release);
+    return (unsigned short)n;
+}
+
+// start measuring a handler call.............................................
+ProfMark profBegin_() {
+    ProfArray *a = (l_array != 0) ? l_array : newArray_();
+    ProfMark m;
+    m.nested = a->nested;
+    m.time = PROF_TIME();
+    return m;
+}
+
+// count a handler call of the state and its time without the nested calls...
+void profEnd_(ProfMark const &m, unsigned short id, ProfKind kind) {
+    unsigned long long t = PROF_TIME() - m.time;
+    ProfArray *a = l_array;
+    ProfCell *c = &a->cell[id];
+    // only this thread writes, no atomic read-modify-write needed
+    c->ctr[kind].store(c->ctr[kind].load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    c->cycles.store(c->cycles.load(std::memory_order_relaxed)
+                    + t - (a->nested - m.nested),
+                    std::memory_order_relaxed);
+    a->nested = m.nested + t;
+}
+
+// sum the counters of a state over the threads..............................
+static void sum_(unsigned id, ProfCounters *sum) {
+    unsigned long long v[PROF_INIT + 1] = { 0 };
+    sum->cycles = 0;
+    for (ProfArray *a = l_arrays.load(std::memory_order_acquire); a != 0;
+         a = a->next)
+    {
+        for (unsigned k = 0; k <= PROF_INIT; ++k) {
+            v[k] += a->cell[id].ctr[k].load(std::memory_order_relaxed);
+        }
+        sum->cycles += a->cell[id].cycles.load(std::memory_order_relaxed);
+    }
+    sum->handled = v[PROF_HANDLED];
+    sum->passed = v[PROF_PASSED];
+    sum->entries = v[PROF_ENTRY];
+    sum->exits = v[PROF_EXIT];
+    sum->inits = v[PROF_INIT];
+}
+
+// write the path of names of a state, returns its length....................
+static unsigned path_(unsigned id, char *buf, unsigned len) {
+    unsigned n = 0;
+    if (l_state[id].super != PROF_NONE) {
+        n = path_(l_state[id].super, buf, len);
+        if (n + 1 < len) {
+            buf[n++] = ';';
+        }
+    }
+    for (char const *s = l_state[id].name; *s != '\0' && n + 1 < len; ++s) {
+        buf[n++] = *s;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+// get the counters of the state with the path "machine;state;...;state".....
+bool profGet(char const *path, ProfCounters *sum) {
+    unsigned n = l_nStates.load(std::memory_order_acquire);
+    char buf[256];
+    for (unsigned i = 0; i < n; ++i) {
+        path_(i, buf, sizeof(buf));
+        if (strcmp(buf, path) == 0) {
+            sum_(i, sum);
+            return true;
+        }
+    }
+    return false;
+}
+
+// dump the handler time of the states as folded stacks (flame graphs).......
+bool profDump(FILE *f) {
+    unsigned n = l_nStates.load(std::memory_order_acquire);
+    char buf[256];
+    bool ok = true;
+    for (unsigned i = 0; ok && i < n; ++i) {
+        ProfCounters sum;
+        sum_(i, &sum);
+        if (sum.cycles != 0) {
+            path_(i, buf, sizeof(buf));
+            ok = fprintf(f, "%s %llu\n", buf, sum.cycles) > 0;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,73 @@
+//
+// hsmprof.hpp -- Per-state profiling counters of the Hsm engine (HSM_PROFILE)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMPROF_HPP_
+#define HSMPROF_HPP_
+
+#include "hsm.hpp"
+
+#include <stdio.h>
+
+#ifndef HSM_PROF_MAX_STATES
+#define HSM_PROF_MAX_STATES 256 // max # of distinct profiled states
+#endif
+#define PROF_NONE 0xFFFF    // id of no profiled state
+
+// Compiled with HSM_PROFILE, the Hsm engine counts for every state the
+// events it handled, the events it passed up to its superstate, its
+// entries, exits and initial transitions, and the time spent in its
+// handler (TSC cycles, without the nested exits and entries). The states
+// of all the machines of a class are counted together, by their path of
+// names from the machine name down, e.g. "HsmTest;s1;s11". Each thread
+// counts in its own array, one cache line per state, so no counter is
+// shared between threads.
+enum ProfKind {
+    PROF_HANDLED,   // event consumed by the state
+    PROF_PASSED,    // event passed up to the superstate
+    PROF_ENTRY,     // state entered
+    PROF_EXIT,      // state exited
+    PROF_INIT       // initial transition of the state
+};
+
+struct ProfCounters {       // counters of one state, summed over threads
+    unsigned long long handled, passed, entries, exits, inits;
+    unsigned long long cycles; // handler time in TSC cycles
+};
+
+struct ProfMark {           // start of a measured handler call
+    unsigned long long time;
+    unsigned long long nested; // time of the calls nested before
+};
+
+unsigned short profState(char const *name, unsigned short super); // id
+ProfMark profBegin_();
+void profEnd_(ProfMark const &mark, unsigned short id, ProfKind kind);
+bool profGet(char const *path, ProfCounters *sum); // false if unknown
+bool profDump(FILE *f);     // "path cycles" lines of the folded stacks
+
+#endif // HSMPROF_HPP_
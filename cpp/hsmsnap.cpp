@@ -0,0 +1,216 @@
+//
+// hsmsnap.cpp -- Snapshot and restore of Hsm state machines
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include <string.h>
+#include "hsmsnap.hpp"
+
+#if defined(_WIN32)
+#include <stdlib.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// HsmSnap Ctor...............................................................
+HsmSnap::HsmSnap(Hsm *p)
+  : proto(p), nStates(0), nHist(0), nVars(0), size(1),
+    layout(2166136261U) // FNV-1a offset basis
+{
+    state(&p->top);
+}
+
+// mix data into the layout hash (FNV-1a).....................................
+void HsmSnap::mix_(void const *data, unsigned len) {
+    for (unsigned i = 0; i < len; ++i) {
+        layout = (layout ^ ((unsigned char const *)data)[i]) * 16777619U;
+    }
+}
+
+// describe the next state....................................................
+void HsmSnap::state(State *s) {
+    assert(nStates < SNAP_MAX_STATES && nStates < SNAP_NONE);
+    stateOff[nStates++] = proto->offsetOf_(s);
+    char const *name = proto->name_(s);
+    mix_(name, (unsigned)strlen(name) + 1);
+}
+
+// describe a history pointer.................................................
+void HsmSnap::hist(State **h) {
+    assert(nHist < SNAP_MAX_HIST);
+    histOff[nHist++] = (unsigned short)((char *)h - (char *)proto);
+    size += 1;
+    mix_("H", 1);
+}
+
+// describe an extended state variable........................................
+void HsmSnap::var(void const *v, unsigned sz) {
+    assert(nVars < SNAP_MAX_VARS && sz < 0x10000);
+    varOff[nVars] = (unsigned short)((char const *)v - (char const *)proto);
+    varSize[nVars++] = (unsigned short)sz;
+    size += sz;
+    mix_(&sz, sizeof(sz));
+}
+
+// id of the state at the offset..............................................
+unsigned char HsmSnap::idOf_(unsigned short offset) const {
+    for (unsigned char id = 0; id < nStates; ++id) {
+        if (stateOff[id] == offset) {
+            return id;
+        }
+    }
+    assert(0); // state not described
+    return SNAP_NONE;
+}
+
+// save one machine into a record of recSize() bytes..........................
+void HsmSnap::save(Hsm const *me, unsigned char *rec) const {
+    assert(me->next == 0); // not in the middle of a transition
+    *rec++ = (me->curr != 0) ? idOf_(me->offsetOf_(me->curr)) : SNAP_NONE;
+    for (unsigned i = 0; i < nHist; ++i) {
+        State const *h = *(State * const *)((char const *)me + histOff[i]);
+        *rec++ = (h != 0) ? idOf_(me->offsetOf_(h)) : SNAP_NONE;
+    }
+    for (unsigned i = 0; i < nVars; ++i) {
+        memcpy(rec, (char const *)me + varOff[i], varSize[i]);
+        rec += varSize[i];
+    }
+}
+
+// check the state ids of a record, which may come from a corrupted image...
+bool HsmSnap::isValid_(unsigned char const *rec) const {
+    for (unsigned i = 0; i <= nHist; ++i) { // current state, then history
+        if (rec[i] != SNAP_NONE && rec[i] >= nStates) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// restore one machine from a record, no entry actions are executed..........
+bool HsmSnap::restore(Hsm *me, unsigned char const *rec) const {
+    if (!isValid_(rec)) {
+        return false; // the machine is left as it was
+    }
+    me->curr = (*rec != SNAP_NONE) ? me->stateAt_(stateOff[*rec]) : 0;
+    me->next = 0;
+    ++rec;
+    for (unsigned i = 0; i < nHist; ++i, ++rec) {
+        *(State **)((char *)me + histOff[i]) =
+            (*rec != SNAP_NONE) ? me->stateAt_(stateOff[*rec]) : 0;
+    }
+    for (unsigned i = 0; i < nVars; ++i) {
+        memcpy((char *)me + varOff[i], rec, varSize[i]);
+        rec += varSize[i];
+    }
+    return true;
+}
+
+// save the image of n machines...............................................
+bool HsmSnap::saveImage(FILE *f, Hsm * const *me, unsigned n) const {
+    SnapFileHdr hdr;
+    memcpy(hdr.magic, "HSMSNAP1", sizeof(hdr.magic));
+    hdr.layout = layout;
+    hdr.recSize = size;
+    hdr.nRec = n;
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+    unsigned char buf[4096];   // records written in blocks
+    unsigned perBuf = sizeof(buf) / size;
+    assert(perBuf != 0);
+    for (unsigned i = 0; ok && i < n; ) {
+        unsigned k = 0;
+        for (; k < perBuf && i < n; ++k, ++i) {
+            save(me[i], &buf[k * size]);
+        }
+        ok = (fwrite(buf, size, k, f) == k);
+    }
+    return ok;
+}
+
+// restore up to n machines from an image in memory...........................
+unsigned HsmSnap::restoreImage(void const *image, size_t len,
+                               Hsm * const *me, unsigned n) const
+{
+    SnapFileHdr hdr;
+    if (len < sizeof(hdr)) {
+        return 0;
+    }
+    memcpy(&hdr, image, sizeof(hdr));
+    if (memcmp(hdr.magic, "HSMSNAP1", sizeof(hdr.magic)) != 0
+        || hdr.layout != layout || hdr.recSize != size
+        || (len - sizeof(hdr)) / size < hdr.nRec)
+    {
+        return 0; // not an image of this class (or truncated)
+    }
+    if (n > hdr.nRec) {
+        n = hdr.nRec;
+    }
+    unsigned char const *rec = (unsigned char const *)image + sizeof(hdr);
+    for (unsigned i = 0; i < n; ++i) { // no machine restored from a bad image
+        if (!isValid_(&rec[(size_t)i * size])) {
+            return 0;
+        }
+    }
+    for (unsigned i = 0; i < n; ++i, rec += size) {
+        restore(me[i], rec);
+    }
+    return n;
+}
+
+// restore up to n machines from an image file, mapped into memory...........
+unsigned HsmSnap::restoreFile(FILE *f, Hsm * const *me, unsigned n) const {
+#if defined(_WIN32)
+    if (fseek(f, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    long len = ftell(f);
+    if (len <= 0 || fseek(f, 0, SEEK_SET) != 0) {
+        return 0;
+    }
+    char *image = new char[len];
+    unsigned nRestored = (fread(image, 1, len, f) == (size_t)len)
+                         ? restoreImage(image, (size_t)len, me, n)
+                         : 0;
+    delete[] image;
+    return nRestored;
+#else
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_size <= 0) {
+        return 0;
+    }
+    size_t len = (size_t)st.st_size;
+    void *image = mmap(0, len, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (image == MAP_FAILED) {
+        return 0;
+    }
+    madvise(image, len, MADV_SEQUENTIAL);
+    unsigned nRestored = restoreImage(image, len, me, n);
+    munmap(image, len);
+    return nRestored;
+#endif
+}
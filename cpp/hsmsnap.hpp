@@ -0,0 +1,94 @@
+//
+// hsmsnap.hpp -- Snapshot and restore of Hsm state machines
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMSNAP_HPP_
+#define HSMSNAP_HPP_
+
+#include "hsm.hpp"
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef SNAP_MAX_STATES
+#define SNAP_MAX_STATES 64  // max # of states of a class (with top)
+#endif
+#ifndef SNAP_MAX_HIST
+#define SNAP_MAX_HIST 8     // max # of history pointers of a class
+#endif
+#ifndef SNAP_MAX_VARS
+#define SNAP_MAX_VARS 16    // max # of extended state variables of a class
+#endif
+
+#define SNAP_NONE 0xFF      // id of no state (not started, no history)
+
+// HsmSnap is the layout of the snapshot of one class of state machines,
+// described once on a prototype instance. The states get stable ids in
+// the order of their description (top is 0), so a snapshot does not
+// depend on the addresses or on the layout of the objects. A machine is
+// saved as one record: the id of its current state, the ids of its
+// history states and its extended state variables (plain data only).
+// Restoring a record sets the current state without any entry actions.
+class HsmSnap {
+public:
+    HsmSnap(Hsm *proto);                   // ctor, proto describes the class
+    void state(State *s);                  // the next state id
+    void hist(State **h);                  // history pointer of the proto
+    void var(void const *v, unsigned size); // extended state of the proto
+    unsigned recSize() const { return size; }
+    void save(Hsm const *me, unsigned char *rec) const;
+    bool restore(Hsm *me, unsigned char const *rec) const; // false if bad
+    // image of n machines (SnapFileHdr and n records), false on error
+    bool saveImage(FILE *f, Hsm * const *me, unsigned n) const;
+    // restore up to n machines from an image, returns the # restored, or
+    // 0 if the image has a different layout or a bad state id
+    unsigned restoreImage(void const *image, size_t len,
+                          Hsm * const *me, unsigned n) const;
+    unsigned restoreFile(FILE *f, Hsm * const *me, unsigned n) const; // mmap
+private:
+    unsigned char idOf_(unsigned short offset) const;
+    bool isValid_(unsigned char const *rec) const; // state ids of a record
+    void mix_(void const *data, unsigned len); // into the layout hash
+    Hsm *proto;
+    unsigned short stateOff[SNAP_MAX_STATES]; // offsets of the states by id
+    unsigned short histOff[SNAP_MAX_HIST];    // offsets of the history ptrs
+    unsigned short varOff[SNAP_MAX_VARS];     // offsets of the variables
+    unsigned short varSize[SNAP_MAX_VARS];
+    unsigned char nStates, nHist, nVars;
+    unsigned size;                 // bytes per record
+    unsigned layout;               // hash of the names, ids and sizes
+};
+
+// Image file: SnapFileHdr, then nRec records of recSize bytes.
+struct SnapFileHdr {
+    char magic[8];           // "HSMSNAP1"
+    unsigned layout;         // HsmSnap layout hash of the class
+    unsigned recSize;        // bytes per record
+    unsigned nRec;           // # of records (machines)
+};
+
+#endif // HSMSNAP_HPP_
@@ -0,0 +1,176 @@
+//
+// hsmsoa.cpp -- Many instances of one state machine in struct-of-arrays storage
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include "hsmsoa.hpp"
+
+static Msg const startMsg = { START_EVT };
+static Msg const entryMsg = { ENTRY_EVT };
+static Msg const exitMsg  = { EXIT_EVT };
+
+// HsmSoA Ctor (the superstates must come first in the state table)..........
+HsmSoA::HsmSoA(SoAState const *s, unsigned nStates, unsigned n)
+  : nInst(n), states(s), bulk(0), nBulk(0), curr(new StateId[n]), inst(0),
+    next(SOA_NONE), source(SOA_NONE)
+{
+    assert(0 < nStates && nStates <= SOA_MAX_STATES);
+    assert(states[SOA_TOP].super == SOA_NONE);
+    depth[SOA_TOP] = 0;
+    for (unsigned i = 1; i < nStates; ++i) {
+        assert(states[i].super < i); // superstate defined first
+        depth[i] = depth[states[i].super] + 1;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        curr[i] = SOA_TOP;
+    }
+}
+
+HsmSoA::~HsmSoA() {
+    delete[] curr;
+}
+
+// enter the states below curr[inst] down to next, outermost first...........
+void HsmSoA::enter_() {
+    StateId path[SOA_MAX_STATES];
+    unsigned n = 0;
+    for (StateId s = next; s != curr[inst]; s = states[s].super) {
+        path[n++] = s; // trace path to target
+    }
+    while (n != 0) { // retrace the entry
+        call_(path[--n], &entryMsg);
+    }
+    curr[inst] = next;
+    next = SOA_NONE;
+}
+
+// take the initial transitions of curr[inst].................................
+void HsmSoA::start_() {
+    while (call_(curr[inst], &startMsg), next != SOA_NONE) {
+        enter_();
+    }
+}
+
+// enter and start the top state of instance i................................
+void HsmSoA::onStart(unsigned i) {
+    inst = i;
+    curr[i] = SOA_TOP;
+    next = SOA_NONE;
+    call_(SOA_TOP, &entryMsg);
+    start_();
+}
+
+// state machine "engine" of instance i.......................................
+void HsmSoA::onEvent(unsigned i, Msg const *msg) {
+    inst = i;
+    for (StateId s = curr[i]; s != SOA_NONE; s = states[s].super) {
+        source = s; // level of outermost event handler
+        msg = call_(s, msg);
+        if (msg == 0) { // processed?
+            if (next != SOA_NONE) { // state transition taken?
+                enter_();          // enter from LCA
+                start_();
+            }
+            break; // event processed
+        }
+    }
+}
+
+void HsmSoA::onStartAll() {
+    for (unsigned i = 0; i < nInst; ++i) {
+        onStart(i);
+    }
+}
+
+void HsmSoA::onEventAll(Msg const *msg) {
+    for (unsigned i = 0; i < nInst; ++i) {
+        onEvent(i, msg);
+    }
+}
+
+// dispatch to all instances, the instances of the bulk states together......
+void HsmSoA::onEventBulk(Msg const *msg) {
+    SoABulk const *b = bulk;
+    SoABulk const *end = bulk + nBulk;
+    for (; b != end && b->sig != msg->evt; ++b) {
+    }
+    if (b == end) { // no bulk action for the signal?
+        onEventAll(msg);
+        return;
+    }
+    unsigned char lut[256] = { 0 }; // 1 for the bulk states
+    for (unsigned s = 0; s < SOA_MAX_STATES && s < 64; ++s) {
+        lut[s] = (unsigned char)((b->states >> s) & 1);
+    }
+    unsigned char sel[SOA_BULK_CHUNK];
+    for (unsigned first = 0; first < nInst; first += SOA_BULK_CHUNK) {
+        unsigned last = (nInst - first > SOA_BULK_CHUNK)
+                        ? first + SOA_BULK_CHUNK : nInst;
+        unsigned nSel = 0;
+        for (unsigned i = first; i < last; ++i) {
+            nSel += (sel[i - first] = lut[curr[i]]);
+        }
+        if (nSel != 0) {
+            (this->*b->action)(sel, first, last);
+        }
+        if (nSel != last - first) { // some instances in other states?
+            for (unsigned i = first; i < last; ++i) {
+                if (sel[i - first] == 0) {
+                    onEvent(i, msg);
+                }
+            }
+        }
+    }
+}
+
+// exit current states and all superstates up to LCA .........................
+void HsmSoA::stateTran(StateId target) {
+    assert(next == SOA_NONE);
+    StateId s = curr[inst];
+    while (s != source) {
+        call_(s, &exitMsg);
+        s = states[s].super;
+    }
+    StateId t = target;
+    if (s == t) { // self-transition
+        call_(s, &exitMsg);
+        s = states[s].super;
+    }
+    else {
+        for (; depth[s] > depth[t]; s = states[s].super) {
+            call_(s, &exitMsg); // climb to the level of the target
+        }
+        while (depth[t] > depth[s]) {
+            t = states[t].super; // climb to the level of the source
+        }
+        for (; s != t; s = states[s].super, t = states[t].super) {
+            call_(s, &exitMsg);
+        }
+    }
+    curr[inst] = s; // the LCA
+    next = target;
+}
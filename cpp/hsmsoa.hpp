@@ -0,0 +1,115 @@
+//
+// hsmsoa.hpp -- Many instances of one state machine in struct-of-arrays storage
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMSOA_HPP_
+#define HSMSOA_HPP_
+
+#include "hsm.hpp" // Msg, Event, START_EVT, ENTRY_EVT, EXIT_EVT
+
+#ifndef SOA_MAX_STATES
+#define SOA_MAX_STATES 64   // max # of states of an HsmSoA machine
+#endif
+
+typedef unsigned char StateId; // index of a state in the state table
+#define SOA_TOP  ((StateId)0)    // the top state is always the first one
+#define SOA_NONE ((StateId)0xFF) // no state
+
+#ifndef SOA_BULK_CHUNK
+#define SOA_BULK_CHUNK 4096 // # of instances selected at a time by onEventBulk()
+#endif
+
+class HsmSoA; // forward declaration
+typedef Msg const *(HsmSoA::*SoAHndlr)(unsigned i, Msg const *msg);
+// action applied to the instances begin..end-1 with sel[i - begin] != 0
+typedef void (HsmSoA::*SoABulkAction)(unsigned char const *sel,
+                                      unsigned begin, unsigned end);
+
+struct SoAState {      // one state, shared by all instances
+    char const *name;
+    StateId super;     // superstate (SOA_NONE for the top state)
+    SoAHndlr hndlr;    // handler of instance i of the machine
+};
+
+struct SoABulk {        // signal handled in bulk in some states
+    Event sig;
+    unsigned long long states; // bit s set for the state s
+    SoABulkAction action;  // same effect as the handlers of these states
+};
+
+// HsmSoA runs many instances of one state machine ("flyweight"). The
+// states form one static table per machine class, so an instance stores
+// only its current state, in one array of StateIds. The derived class
+// keeps the extended state variables of the instances in arrays as well,
+// indexed by the instance, and its handlers get the index of the
+// instance. Dispatching an event to all instances in order streams
+// through the arrays.
+// onEventBulk() dispatches an event to all instances grouped by their
+// current states instead. The instances in the states of a SoABulk entry
+// of the signal are handled together by its action, which can process
+// the arrays with SIMD instructions. The action must have the same effect
+// as the handlers would have, without a state transition. The remaining
+// instances get the event one at a time.
+class HsmSoA {
+public:
+    HsmSoA(SoAState const *states, unsigned nStates, unsigned nInst); // ctor
+    ~HsmSoA();
+    void onStart(unsigned i);                 // start instance i
+    void onEvent(unsigned i, Msg const *msg); // dispatch to instance i
+    void onStartAll();                        // start all instances
+    void onEventAll(Msg const *msg);          // dispatch to all instances
+    void onEventBulk(Msg const *msg);         // the same, grouped by state
+    StateId stateOf(unsigned i) const { return curr[i]; }
+    char const *nameOf(StateId s) const { return states[s].name; }
+    unsigned const nInst;          // # of instances
+protected:
+    StateId STATE_CURR() const { return curr[inst]; }
+    void stateStart(StateId target) { // initial transition
+        next = target;
+    }
+    void stateTran(StateId target);   // transition (exits up to the LCA)
+    void setBulk(SoABulk const *tbl, unsigned n) { // in the ctor
+        bulk = tbl;
+        nBulk = n;
+    }
+private:
+    Msg const *call_(StateId s, Msg const *msg) {
+        return (this->*states[s].hndlr)(inst, msg);
+    }
+    void enter_();                 // enter from curr[inst] down to next
+    void start_();                 // take the initial transitions
+    SoAState const *states;        // state table of the machine class
+    SoABulk const *bulk;           // bulk actions of the machine class
+    unsigned nBulk;
+    unsigned char depth[SOA_MAX_STATES]; // nesting levels (top is 0)
+    StateId *curr;                 // current states of all instances
+    unsigned inst;                 // instance being dispatched
+    StateId next;                  // next state (SOA_NONE if none)
+    StateId source;                // source state of the transition
+};
+
+#endif // HSMSOA_HPP_
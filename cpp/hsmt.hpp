@@ -0,0 +1,205 @@
+//
+// hsmt.hpp -- Hierarchical State Machine engine resolved at compile time
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMT_HPP_
+#define HSMT_HPP_
+
+#include "hsm.hpp" // Msg, Event, START_EVT, ENTRY_EVT, EXIT_EVT
+
+#include <assert.h>
+#include <type_traits>
+
+// In the HsmT engine the states are types. A state type names its
+// superstate, so the state hierarchy is known to the compiler:
+//
+//   struct S1  : SubstateOf<TopState> {};
+//   struct S11 : SubstateOf<S1> {};
+//
+// The state machine class derives from HsmT<itself> and handles each state
+// in an overload of hndlr() taking the state type as the first argument.
+// A handler passes that argument on to name the source of a transition:
+//
+//   Msg const *hndlr(S11 s, Msg const *msg) {
+//       ...
+//       stateTran<S211>(s);
+//
+// The engine calls the handlers of the current state and its superstates
+// directly, and the exits and entries of every transition are expanded at
+// compile time, so the optimizer can inline the handlers. The only indirect
+// calls are one per event (the current state) and one per transition.
+// The engine requires C++17 (if constexpr).
+
+struct TopState { // the top-most state of every HsmT
+    static constexpr unsigned depth = 0;
+};
+
+template<class S>
+struct SubstateOf { // base of all the other state types
+    typedef S Super;
+    static constexpr unsigned depth = S::depth + 1;
+};
+
+// is the state A the state S or one of its superstates?......................
+template<class A, class S>
+constexpr bool isInState() {
+    if constexpr (std::is_same<A, S>::value) {
+        return true;
+    }
+    else if constexpr (S::depth == 0) {
+        return false;
+    }
+    else {
+        return isInState<A, typename S::Super>();
+    }
+}
+
+// superstate of S at the nesting level depth.................................
+template<class S, unsigned depth, bool = (S::depth == depth)>
+struct SuperAt_ {
+    typedef typename SuperAt_<typename S::Super, depth>::type type;
+};
+template<class S, unsigned depth>
+struct SuperAt_<S, depth, true> {
+    typedef S type;
+};
+
+// Least Common Ancestor of the source S and the target T of a transition.....
+template<class S, class T, bool = (S::depth == T::depth)>
+struct LcaOf_ { // bring the deeper state to the level of the other one
+    static constexpr unsigned depth = S::depth < T::depth ? S::depth
+                                                          : T::depth;
+    typedef typename LcaOf_<typename SuperAt_<S, depth>::type,
+                          typename SuperAt_<T, depth>::type>::type type;
+};
+template<class S, class T>
+struct LcaOf_<S, T, true> { // states at the same level
+    typedef typename LcaOf_<typename S::Super, typename T::Super>::type type;
+};
+template<class S>
+struct LcaOf_<S, S, true> {
+    typedef S type;
+};
+
+template<class S, class T>
+struct LcaOf { // exits the source S unless T is a substate of S
+    typedef typename LcaOf_<S, T>::type type;
+};
+template<class S>
+struct LcaOf<S, S> { // self-transition exits and enters the state again
+    typedef typename S::Super type;
+};
+
+template<class Derived>
+class HsmT { // Hierarchical State Machine with the hierarchy in types
+    typedef void (*Dispatch)(Derived *me, Msg const *msg);
+    typedef void (*Tran)(Derived *me);
+    Dispatch curr;    // dispatcher of the current state
+    Tran next;        // transition taken (0 if none)
+    char const *name; // pointer to static name
+public:
+    HsmT(char const *n) : curr(0), next(0), name(n) {}
+    void onStart() {  // enter and start the top state
+        me_()->hndlr(TopState(), &entryMsg_);
+        start_<TopState>(me_());
+    }
+    void onEvent(Msg const *msg) { // state machine "engine"
+        (*curr)(me_(), msg);
+    }
+protected:
+    template<class T, class S>
+    void stateTran(S) {   // transition from the handler of S to T
+        assert(next == 0);
+        next = &tran_<S, T>;
+    }
+    template<class T, class S>
+    void stateStart(S) {  // initial transition of S to its substate T
+        static_assert(isInState<S, T>() && !std::is_same<S, T>::value,
+                      "initial transition must target a substate");
+        next = &tran_<S, T>;
+    }
+private:
+    static constexpr Msg startMsg_ = { START_EVT };
+    static constexpr Msg entryMsg_ = { ENTRY_EVT };
+    static constexpr Msg exitMsg_  = { EXIT_EVT };
+
+    Derived *me_() { return static_cast<Derived *>(this); }
+
+    // handle msg in the current state L, or else in the superstate S.....
+    template<class L, class S>
+    static void dispatch_(Derived *me, Msg const *msg) {
+        msg = me->hndlr(S(), msg);
+        if (msg == 0) { // processed?
+            if (me->next != 0) { // state transition taken?
+                exit_<L, S>(me); // exit the states below the source
+                take_(me);
+            }
+        }
+        else if constexpr (S::depth != 0) {
+            dispatch_<L, typename S::Super>(me, msg);
+        }
+    }
+    static void take_(Derived *me) { // take the transition recorded in next
+        Tran t = me->next;
+        me->next = 0;
+        (*t)(me);
+    }
+    // exit the state S and its superstates up to (not including) A.......
+    template<class S, class A>
+    static void exit_(Derived *me) {
+        if constexpr (!std::is_same<S, A>::value) {
+            me->hndlr(S(), &exitMsg_);
+            exit_<typename S::Super, A>(me);
+        }
+    }
+    // enter the state T and its superstates below A, outermost first.....
+    template<class A, class T>
+    static void enter_(Derived *me) {
+        if constexpr (!std::is_same<A, T>::value) {
+            enter_<A, typename T::Super>(me);
+            me->hndlr(T(), &entryMsg_);
+        }
+    }
+    // transition from S to T, then the initial transitions of T..........
+    template<class S, class T>
+    static void tran_(Derived *me) {
+        typedef typename LcaOf<S, T>::type A;
+        exit_<S, A>(me);
+        enter_<A, T>(me);
+        start_<T>(me);
+    }
+    template<class T>
+    static void start_(Derived *me) {
+        me->curr = &dispatch_<T, T>;
+        me->hndlr(T(), &startMsg_);
+        if (me->next != 0) { // initial transition taken?
+            take_(me);
+        }
+    }
+};
+
+#endif // HSMT_HPP_
@@ -0,0 +1,160 @@
+//
+// hsmtrace.cpp -- Binary tracing of the Hsm engine (HSM_TRACE)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include <string.h>
+#include "hsmtrace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TRACE_TIME() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_TIME() __rdtsc()
+#else
+#define TRACE_TIME() ((unsigned long long) \
+    std::chrono::duration_cast<std::chrono::nanoseconds>( \
+        std::chrono::steady_clock::now().time_since_epoch()).count())
+#endif
+
+struct TraceRing {                // ring buffer of one thread
+    TraceRec rec[HSM_TRACE_LEN];
+    std::atomic<unsigned long long> head; // # of records ever written
+    unsigned char thread;         // id of the thread
+    TraceRing *next;              // next ring in l_rings
+};
+
+// The rings are never freed, so the records of the threads that have
+// ended can still be dumped.
+static std::atomic<TraceRing *> l_rings;     // all rings, newest first
+static std::atomic<unsigned> l_nThreads;     // # of rings
+static std::atomic<unsigned> l_nHsm;         // # of traced machines
+static thread_local TraceRing *l_ring;       // ring of the current thread
+
+// create and register the ring of the current thread.........................
+static TraceRing *newRing_() {
+    TraceRing *r = new TraceRing;
+    r->head.store(0, std::memory_order_relaxed);
+    r->thread = (unsigned char)l_nThreads.fetch_add(1);
+    r->next = l_rings.load(std::memory_order_relaxed);
+    while (!l_rings.compare_exchange_weak(r->next, r,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed))
+    {}
+    l_ring = r;
+    return r;
+}
+
+// write one record to the ring of the current thread.........................
+void traceRec(TraceKind kind, unsigned hsm, char const *name, Event evt)
+{
+    TraceRing *r = (l_ring != 0) ? l_ring : newRing_();
+    unsigned long long h = r->head.load(std::memory_order_relaxed);
+    TraceRec *rec = &r->rec[h & (HSM_TRACE_LEN - 1)];
+    rec->time = TRACE_TIME();
+    rec->name = name;
+    rec->evt = evt;
+    rec->hsm = hsm;
+    rec->kind = (unsigned char)kind;
+    rec->thread = r->thread;
+    r->head.store(h + 1, std::memory_order_release); // publish the record
+}
+
+// assign an id to a new machine..............................................
+unsigned traceHsm(char const *name) {
+    unsigned id = l_nHsm.fetch_add(1, std::memory_order_relaxed);
+    traceRec(TRACE_HSM, id, name, 0);
+    return id;
+}
+
+static bool byTime_(TraceRec const &a, TraceRec const &b) {
+    return a.time < b.time;
+}
+static bool byName_(TraceRec const &a, TraceRec const &b) {
+    return a.name < b.name;
+}
+
+// save the records of all threads............................................
+// Records that a thread overwrites while they are being copied are dropped.
+bool traceDump(FILE *f) {
+    unsigned max = l_nThreads.load() * HSM_TRACE_LEN;
+    TraceRec *rec = new TraceRec[max + 1]; // + 1 to never allocate 0
+    unsigned n = 0;
+    for (TraceRing *r = l_rings.load(std::memory_order_acquire);
+         r != 0 && n + HSM_TRACE_LEN <= max; // skip rings added meanwhile
+         r = r->next)
+    {
+        unsigned long long h = r->head.load(std::memory_order_acquire);
+        unsigned long long lo = (h > HSM_TRACE_LEN) ? h - HSM_TRACE_LEN : 0;
+        unsigned first = n;
+        for (unsigned long long i = lo; i < h; ++i) {
+            rec[n++] = r->rec[i & (HSM_TRACE_LEN - 1)];
+        }
+        // record h2 (being written) overwrites the record h2 - HSM_TRACE_LEN
+        unsigned long long h2 = r->head.load(std::memory_order_acquire) + 1;
+        unsigned long long lo2 = (h2 > HSM_TRACE_LEN) ? h2 - HSM_TRACE_LEN : 0;
+        if (lo2 > lo) { // some copied records overwritten?
+            unsigned drop = (unsigned)std::min(lo2 - lo, h - lo);
+            memmove(&rec[first], &rec[first + drop],
+                    (n - first - drop) * sizeof(TraceRec));
+            n -= drop;
+        }
+    }
+    std::stable_sort(rec, rec + n, byTime_);
+
+    TraceRec *str = new TraceRec[n + 1]; // distinct names
+    std::copy(rec, rec + n, str);
+    std::sort(str, str + n, byName_);
+    unsigned nStr = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        if (nStr == 0 || str[i].name != str[nStr - 1].name) {
+            str[nStr++] = str[i];
+        }
+    }
+    TraceFileHdr hdr;
+    memcpy(hdr.magic, "HSMTRAC2", sizeof(hdr.magic));
+    hdr.nStr = nStr;
+    hdr.nRec = n;
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+    for (unsigned i = 0; ok && i < nStr; ++i) {
+        unsigned long long ptr = (unsigned long long)(size_t)str[i].name;
+        unsigned short len = (str[i].name != 0)
+                             ? (unsigned short)strlen(str[i].name) : 0;
+        ok = fwrite(&ptr, sizeof(ptr), 1, f) == 1
+             && fwrite(&len, sizeof(len), 1, f) == 1
+             && fwrite(str[i].name, 1, len, f) == len;
+    }
+    ok = ok && fwrite(rec, sizeof(TraceRec), n, f) == n;
+    delete[] str;
+    delete[] rec;
+    return ok;
+}
@@ -0,0 +1,77 @@
+//
+// hsmtrace.hpp -- Binary tracing of the Hsm engine (HSM_TRACE)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef HSMTRACE_HPP_
+#define HSMTRACE_HPP_
+
+#include "hsm.hpp"
+
+#include <stdio.h>
+
+#ifndef HSM_TRACE_LEN
+#define HSM_TRACE_LEN 4096  // # of records per thread, must be a power of 2
+#endif
+
+// Compiled with HSM_TRACE, the Hsm engine writes one record for every
+// event a state consumes, every transition, entry, exit and initial
+// transition into a ring buffer of the calling thread. Each thread writes
+// only to its own ring, so recording takes no lock and no atomic
+// read-modify-write. A full ring overwrites its oldest records.
+// traceDump() saves all the rings, and the tracedec program decodes them.
+enum TraceKind {
+    TRACE_HSM,      // a machine was constructed (name of the machine)
+    TRACE_DISPATCH, // event consumed without a transition
+    TRACE_TRAN,     // event consumed with a transition (source state)
+    TRACE_ENTRY,    // state entered
+    TRACE_EXIT,     // state exited
+    TRACE_INIT      // initial transition taken by the state
+};
+
+struct TraceRec {            // one binary trace record
+    unsigned long long time; // time stamp (TSC or steady clock ns)
+    char const *name;        // name of the state (or of the machine)
+    Event evt;               // event
+    unsigned hsm;            // id of the machine
+    unsigned char kind;      // TraceKind
+    unsigned char thread;    // id of the recording thread
+};
+
+unsigned traceHsm(char const *name); // new machine id, TRACE_HSM
+void traceRec(TraceKind kind, unsigned hsm, char const *name, Event evt);
+bool traceDump(FILE *f);     // save all the rings, false on error
+
+// Dump file: TraceFileHdr, then nStr strings (the name pointer as an
+// unsigned long long, the length as an unsigned short and the characters),
+// then nRec TraceRecs in the order of time.
+struct TraceFileHdr {
+    char magic[8];           // "HSMTRAC2" (2: 32-bit machine ids)
+    unsigned nStr;           // # of distinct names
+    unsigned nRec;           // # of records
+};
+
+#endif // HSMTRACE_HPP_
@@ -7,47 +7,29 @@
 //  M. Samek 02-11-25
 //
 
-#include "hsm.hpp"
+#include "hsmtst.hpp"
 
 #include <assert.h>
 #include <stdio.h>
 
-class HsmTest : public Hsm {
-    int myFoo;
-protected:
-    State s1;
-      State s11;
-    State s2;
-      State s21;
-        State s211;
-public:
-    HsmTest();
-    Msg const *topHndlr(Msg const *msg);
-    Msg const *s1Hndlr(Msg const *msg);
-    Msg const *s11Hndlr(Msg const *msg);
-    Msg const *s2Hndlr(Msg const *msg);
-    Msg const *s21Hndlr(Msg const *msg);
-    Msg const *s211Hndlr(Msg const *msg);
-};
-
-enum HsmTestEvents {
-    A_SIG, B_SIG, C_SIG, D_SIG, E_SIG, F_SIG, G_SIG, H_SIG
-};
+#ifdef HSM_TRACE
+#include "hsmtrace.hpp"
+#endif
 
 Msg const *HsmTest::topHndlr(Msg const *msg) {
     switch (msg->evt) {
     case START_EVT:
-        printf("top-INIT;");
+        HSMTST_PRINT("top-INIT;");
         STATE_START(&s1);
         return 0;
     case ENTRY_EVT:
-        printf("top-ENTRY;");
+        HSMTST_PRINT("top-ENTRY;");
         return 0;
     case EXIT_EVT:
-        printf("top-EXIT;");
+        HSMTST_PRINT("top-EXIT;");
         return 0;
     case E_SIG:
-        printf("top-E;");
+        HSMTST_PRINT("top-E;");
         STATE_TRAN(&s211);
         return 0;
     }
@@ -57,33 +39,33 @@ Msg const *HsmTest::topHndlr(Msg const *msg) {
 Msg const *HsmTest::s1Hndlr(Msg const *msg) {
     switch (msg->evt) {
     case START_EVT:
-        printf("s1-INIT;");
+        HSMTST_PRINT("s1-INIT;");
         STATE_START(&s11);
         return 0;
     case ENTRY_EVT:
-        printf("s1-ENTRY;");
+        HSMTST_PRINT("s1-ENTRY;");
         return 0;
     case EXIT_EVT:
-        printf("s1-EXIT;");
+        HSMTST_PRINT("s1-EXIT;");
         return 0;
     case A_SIG:
-        printf("s1-A;");
+        HSMTST_PRINT("s1-A;");
         STATE_TRAN(&s1);
         return 0;
     case B_SIG:
-        printf("s1-B;");
+        HSMTST_PRINT("s1-B;");
         STATE_TRAN(&s11);
         return 0;
     case C_SIG:
-        printf("s1-C;");
+        HSMTST_PRINT("s1-C;");
         STATE_TRAN(&s2);
         return 0;
     case D_SIG:
-        printf("s1-D;");
+        HSMTST_PRINT("s1-D;");
         STATE_TRAN(&top);
         return 0;
     case F_SIG:
-        printf("s1-F;");
+        HSMTST_PRINT("s1-F;");
         STATE_TRAN(&s211);
         return 0;
     }
@@ -93,18 +75,18 @@ Msg const *HsmTest::s1Hndlr(Msg const *msg) {
 Msg const *HsmTest::s11Hndlr(Msg const *msg) {
     switch (msg->evt) {
     case ENTRY_EVT:
-        printf("s11-ENTRY;");
+        HSMTST_PRINT("s11-ENTRY;");
         return 0;
     case EXIT_EVT:
-        printf("s11-EXIT;");
+        HSMTST_PRINT("s11-EXIT;");
         return 0;
     case G_SIG:
-        printf("s11-G;");
+        HSMTST_PRINT("s11-G;");
         STATE_TRAN(&s211);
         return 0;
     case H_SIG:
         if (myFoo) {
-            printf("s11-H;");
+            HSMTST_PRINT("s11-H;");
             myFoo = 0;
             return 0;
         }
@@ -116,21 +98,21 @@ Msg const *HsmTest::s11Hndlr(Msg const *msg) {
 Msg const *HsmTest::s2Hndlr(Msg const *msg) {
     switch (msg->evt) {
     case START_EVT:
-        printf("s2-INIT;");
+        HSMTST_PRINT("s2-INIT;");
         STATE_START(&s21);
         return 0;
     case ENTRY_EVT:
-        printf("s2-ENTRY;");
+        HSMTST_PRINT("s2-ENTRY;");
         return 0;
     case EXIT_EVT:
-        printf("s2-EXIT;");
+        HSMTST_PRINT("s2-EXIT;");
         return 0;
     case C_SIG:
-        printf("s2-C;");
+        HSMTST_PRINT("s2-C;");
         STATE_TRAN(&s1);
         return 0;
     case F_SIG:
-        printf("s2-F;");
+        HSMTST_PRINT("s2-F;");
         STATE_TRAN(&s11);
         return 0;
     }
@@ -140,22 +122,22 @@ Msg const *HsmTest::s2Hndlr(Msg const *msg) {
 Msg const *HsmTest::s21Hndlr(Msg const *msg) {
     switch (msg->evt) {
     case START_EVT:
-        printf("s21-INIT;");
+        HSMTST_PRINT("s21-INIT;");
         STATE_START(&s211);
         return 0;
     case ENTRY_EVT:
-        printf("s21-ENTRY;");
+        HSMTST_PRINT("s21-ENTRY;");
         return 0;
     case EXIT_EVT:
-        printf("s21-EXIT;");
+        HSMTST_PRINT("s21-EXIT;");
         return 0;
     case B_SIG:
-        printf("s21-B;");
+        HSMTST_PRINT("s21-B;");
         STATE_TRAN(&s211);
         return 0;
     case H_SIG:
         if (!myFoo) {
-            printf("s21-H;");
+            HSMTST_PRINT("s21-H;");
             myFoo = 1;
             STATE_TRAN(&s21);
             return 0;
@@ -168,17 +150,17 @@ Msg const *HsmTest::s21Hndlr(Msg const *msg) {
 Msg const *HsmTest::s211Hndlr(Msg const *msg) {
     switch (msg->evt) {
     case ENTRY_EVT:
-        printf("s211-ENTRY;");
+        HSMTST_PRINT("s211-ENTRY;");
         return 0;
     case EXIT_EVT:
-        printf("s211-EXIT;");
+        HSMTST_PRINT("s211-EXIT;");
         return 0;
     case D_SIG:
-        printf("s211-D;");
+        HSMTST_PRINT("s211-D;");
         STATE_TRAN(&s21);
         return 0;
     case G_SIG:
-        printf("s211-G;");
+        HSMTST_PRINT("s211-G;");
         STATE_TRAN(&top);
         return 0;
     }
@@ -194,13 +176,28 @@ HsmTest::HsmTest()
     s211("s211", &s21,  static_cast<EvtHndlr>(&HsmTest::s211Hndlr))
 {
     myFoo = 0;
+    STATE_HANDLES(&top, E_SIG); // signals handled, for HSM_SIG_TABLES
+    STATE_HANDLES(&s1, A_SIG);
+    STATE_HANDLES(&s1, B_SIG);
+    STATE_HANDLES(&s1, C_SIG);
+    STATE_HANDLES(&s1, D_SIG);
+    STATE_HANDLES(&s1, F_SIG);
+    STATE_HANDLES(&s11, G_SIG);
+    STATE_HANDLES(&s11, H_SIG);
+    STATE_HANDLES(&s2, C_SIG);
+    STATE_HANDLES(&s2, F_SIG);
+    STATE_HANDLES(&s21, B_SIG);
+    STATE_HANDLES(&s21, H_SIG);
+    STATE_HANDLES(&s211, D_SIG);
+    STATE_HANDLES(&s211, G_SIG);
 }
 
-const Msg HsmTestMsg[] = {
+Msg const HsmTestMsg[] = {
     { A_SIG }, { B_SIG }, { C_SIG }, { D_SIG },
     { E_SIG }, { F_SIG }, { G_SIG } ,{ H_SIG }
 };
 
+#ifndef HSMTST_NO_MAIN
 int main() {
     HsmTest hsmTest;
 
@@ -219,5 +216,13 @@ int main() {
         }
         hsmTest.onEvent(&HsmTestMsg[c - 'a']);
     }
+#ifdef HSM_TRACE
+    FILE *f = fopen("hsmtst.trc", "wb"); // decode with tracedec
+    if (f != 0) {
+        traceDump(f);
+        fclose(f);
+    }
+#endif
     return 0;
 }
+#endif // HSMTST_NO_MAIN
@@ -0,0 +1,39 @@
+//
+// hsmtst.hpp -- Hierarchical State Machine test machine
+//
+#ifndef HSMTST_HPP_
+#define HSMTST_HPP_
+
+#include "hsm.hpp"
+
+class HsmTest : public Hsm {
+    int myFoo;
+protected:
+    State s1;
+      State s11;
+    State s2;
+      State s21;
+        State s211;
+public:
+    HsmTest();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *s1Hndlr(Msg const *msg);
+    Msg const *s11Hndlr(Msg const *msg);
+    Msg const *s2Hndlr(Msg const *msg);
+    Msg const *s21Hndlr(Msg const *msg);
+    Msg const *s211Hndlr(Msg const *msg);
+};
+
+enum HsmTestEvents {
+    A_SIG, B_SIG, C_SIG, D_SIG, E_SIG, F_SIG, G_SIG, H_SIG
+};
+
+extern Msg const HsmTestMsg[];
+
+#ifdef HSMTST_QUIET
+#define HSMTST_PRINT(str_) ((void)0)
+#else
+#define HSMTST_PRINT(str_) printf(str_)
+#endif
+
+#endif // HSMTST_HPP_
@@ -0,0 +1,39 @@
+//
+// hsmtstg.cpp -- HsmTest of hsmtst.cpp generated by hsmgen from hsmtst.hsm.
+// It produces the same output as hsmtst.cpp for the same input.
+//
+// Build:
+// hsmgen hsmtst.hsm hsmtstgen
+// g++ hsmtstg.cpp hsmtstgen.cpp hsm.cpp -o hsmtstg
+//
+
+#include "hsmtstgen.hpp"
+
+#include <stdio.h>
+
+#ifndef HSMTST_NO_MAIN
+int main() {
+    static Msg const msg[] = {
+        { A_SIG }, { B_SIG }, { C_SIG }, { D_SIG },
+        { E_SIG }, { F_SIG }, { G_SIG } ,{ H_SIG }
+    };
+    HsmTestGen hsmTest;
+
+    printf("Events:\n"
+        "a-h for triggering events\n"
+        "x to exit\n\n");
+
+    hsmTest.onStart();
+    for (;;) {
+        int c;
+        printf("\nEvent<-");
+        c = getc(stdin);
+        getc(stdin);
+        if (c < 'a' || 'h' < c) {
+            break;
+        }
+        hsmTest.onEvent(&msg[c - 'a']);
+    }
+    return 0;
+}
+#endif // HSMTST_NO_MAIN
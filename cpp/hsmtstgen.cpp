@@ -0,0 +1,405 @@
+//
+// hsmtstgen.cpp -- generated by hsmgen from hsmtst.hsm, do not edit
+//
+#include "hsmtstgen.hpp"
+
+static_assert(A_SIG == 0
+              && B_SIG == 1
+              && C_SIG == 2
+              && D_SIG == 3
+              && E_SIG == 4
+              && F_SIG == 5
+              && G_SIG == 6
+              && H_SIG == 7,
+              "signals 0, 1, 2, ... in the order of the description");
+
+// case 1: top-E_SIG
+// case 2: s1-A_SIG
+// case 3: s1-B_SIG
+// case 4: s1-C_SIG
+// case 5: s1-D_SIG
+// case 6: s1-E_SIG
+// case 7: s1-F_SIG
+// case 8: s11-A_SIG
+// case 9: s11-B_SIG
+// case 10: s11-C_SIG
+// case 11: s11-D_SIG
+// case 12: s11-E_SIG
+// case 13: s11-F_SIG
+// case 14: s11-G_SIG
+// case 15: s11-H_SIG
+// case 16: s2-C_SIG
+// case 17: s2-E_SIG
+// case 18: s2-F_SIG
+// case 19: s21-B_SIG
+// case 20: s21-C_SIG
+// case 21: s21-E_SIG
+// case 22: s21-F_SIG
+// case 23: s21-H_SIG
+// case 24: s211-B_SIG
+// case 25: s211-C_SIG
+// case 26: s211-D_SIG
+// case 27: s211-E_SIG
+// case 28: s211-F_SIG
+// case 29: s211-G_SIG
+// case 30: s211-H_SIG
+
+// the case of the code of every state and signal (0 if none)
+static unsigned char const l_tbl[6][8] = {
+    { 0, 0, 0, 0, 1, 0, 0, 0 }, // top
+    { 2, 3, 4, 5, 6, 7, 0, 0 }, // s1
+    { 8, 9, 10, 11, 12, 13, 14, 15 }, // s11
+    { 0, 0, 16, 0, 17, 18, 0, 0 }, // s2
+    { 0, 19, 20, 0, 21, 22, 0, 23 }, // s21
+    { 0, 24, 25, 26, 27, 28, 29, 30 } // s211
+};
+
+char const * const HsmTestGen::stateName[N_STATES] = {
+    "top",
+    "s1",
+    "s11",
+    "s2",
+    "s21",
+    "s211"
+};
+
+void HsmTestGen::topEntry_() {
+    HSMTST_PRINT("top-ENTRY;");
+}
+
+void HsmTestGen::topExit_() {
+    HSMTST_PRINT("top-EXIT;");
+}
+
+void HsmTestGen::s1Entry_() {
+    HSMTST_PRINT("s1-ENTRY;");
+}
+
+void HsmTestGen::s1Exit_() {
+    HSMTST_PRINT("s1-EXIT;");
+}
+
+void HsmTestGen::s11Entry_() {
+    HSMTST_PRINT("s11-ENTRY;");
+}
+
+void HsmTestGen::s11Exit_() {
+    HSMTST_PRINT("s11-EXIT;");
+}
+
+void HsmTestGen::s2Entry_() {
+    HSMTST_PRINT("s2-ENTRY;");
+}
+
+void HsmTestGen::s2Exit_() {
+    HSMTST_PRINT("s2-EXIT;");
+}
+
+void HsmTestGen::s21Entry_() {
+    HSMTST_PRINT("s21-ENTRY;");
+}
+
+void HsmTestGen::s21Exit_() {
+    HSMTST_PRINT("s21-EXIT;");
+}
+
+void HsmTestGen::s211Entry_() {
+    HSMTST_PRINT("s211-ENTRY;");
+}
+
+void HsmTestGen::s211Exit_() {
+    HSMTST_PRINT("s211-EXIT;");
+}
+
+Msg const *HsmTestGen::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        HSMTST_PRINT("top-INIT;");
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case ENTRY_EVT:
+        topEntry_();
+        return 0;
+    case EXIT_EVT:
+        topExit_();
+        return 0;
+    }
+    if ((unsigned)msg->evt >= N_SIGS) {
+        return msg;
+    }
+    switch (l_tbl[currId][msg->evt]) {
+    case 1:
+        HSMTST_PRINT("top-E;");
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 2:
+        HSMTST_PRINT("s1-A;");
+        s1Exit_();
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 3:
+        HSMTST_PRINT("s1-B;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 4:
+        HSMTST_PRINT("s1-C;");
+        s1Exit_();
+        s2Entry_();
+        HSMTST_PRINT("s2-INIT;");
+        s21Entry_();
+        HSMTST_PRINT("s21-INIT;");
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 5:
+        HSMTST_PRINT("s1-D;");
+        s1Exit_();
+        HSMTST_PRINT("top-INIT;");
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 6:
+        HSMTST_PRINT("top-E;");
+        s1Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 7:
+        HSMTST_PRINT("s1-F;");
+        s1Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 8:
+        HSMTST_PRINT("s1-A;");
+        s11Exit_();
+        s1Exit_();
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 9:
+        HSMTST_PRINT("s1-B;");
+        s11Exit_();
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 10:
+        HSMTST_PRINT("s1-C;");
+        s11Exit_();
+        s1Exit_();
+        s2Entry_();
+        HSMTST_PRINT("s2-INIT;");
+        s21Entry_();
+        HSMTST_PRINT("s21-INIT;");
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 11:
+        HSMTST_PRINT("s1-D;");
+        s11Exit_();
+        s1Exit_();
+        HSMTST_PRINT("top-INIT;");
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 12:
+        HSMTST_PRINT("top-E;");
+        s11Exit_();
+        s1Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 13:
+        HSMTST_PRINT("s1-F;");
+        s11Exit_();
+        s1Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 14:
+        HSMTST_PRINT("s11-G;");
+        s11Exit_();
+        s1Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 15:
+        if (myFoo) {
+            HSMTST_PRINT("s11-H;"); myFoo = 0;
+            return 0;
+        }
+        break;
+    case 16:
+        HSMTST_PRINT("s2-C;");
+        s2Exit_();
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 17:
+        HSMTST_PRINT("top-E;");
+        s2Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 18:
+        HSMTST_PRINT("s2-F;");
+        s2Exit_();
+        s1Entry_();
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 19:
+        HSMTST_PRINT("s21-B;");
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 20:
+        HSMTST_PRINT("s2-C;");
+        s21Exit_();
+        s2Exit_();
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 21:
+        HSMTST_PRINT("top-E;");
+        s21Exit_();
+        s2Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 22:
+        HSMTST_PRINT("s2-F;");
+        s21Exit_();
+        s2Exit_();
+        s1Entry_();
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 23:
+        if (!myFoo) {
+            HSMTST_PRINT("s21-H;"); myFoo = 1;
+            s21Exit_();
+            s21Entry_();
+            HSMTST_PRINT("s21-INIT;");
+            s211Entry_();
+            currId = 5; // s211
+            return 0;
+        }
+        break;
+    case 24:
+        HSMTST_PRINT("s21-B;");
+        s211Exit_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 25:
+        HSMTST_PRINT("s2-C;");
+        s211Exit_();
+        s21Exit_();
+        s2Exit_();
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 26:
+        HSMTST_PRINT("s211-D;");
+        s211Exit_();
+        HSMTST_PRINT("s21-INIT;");
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 27:
+        HSMTST_PRINT("top-E;");
+        s211Exit_();
+        s21Exit_();
+        s2Exit_();
+        s2Entry_();
+        s21Entry_();
+        s211Entry_();
+        currId = 5; // s211
+        return 0;
+    case 28:
+        HSMTST_PRINT("s2-F;");
+        s211Exit_();
+        s21Exit_();
+        s2Exit_();
+        s1Entry_();
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 29:
+        HSMTST_PRINT("s211-G;");
+        s211Exit_();
+        s21Exit_();
+        s2Exit_();
+        HSMTST_PRINT("top-INIT;");
+        s1Entry_();
+        HSMTST_PRINT("s1-INIT;");
+        s11Entry_();
+        currId = 2; // s11
+        return 0;
+    case 30:
+        if (!myFoo) {
+            HSMTST_PRINT("s21-H;"); myFoo = 1;
+            s211Exit_();
+            s21Exit_();
+            s21Entry_();
+            HSMTST_PRINT("s21-INIT;");
+            s211Entry_();
+            currId = 5; // s211
+            return 0;
+        }
+        break;
+    }
+    return msg;
+}
+
+HsmTestGen::HsmTestGen()
+  : Hsm("HsmTestGen", static_cast<EvtHndlr>(&HsmTestGen::topHndlr)),
+    myFoo(0),
+    currId(0)
+{
+    STATE_HANDLES(&top, A_SIG);
+    STATE_HANDLES(&top, B_SIG);
+    STATE_HANDLES(&top, C_SIG);
+    STATE_HANDLES(&top, D_SIG);
+    STATE_HANDLES(&top, E_SIG);
+    STATE_HANDLES(&top, F_SIG);
+    STATE_HANDLES(&top, G_SIG);
+    STATE_HANDLES(&top, H_SIG);
+}
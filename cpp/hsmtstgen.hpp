@@ -0,0 +1,35 @@
+//
+// hsmtstgen.hpp -- generated by hsmgen from hsmtst.hsm, do not edit
+//
+#ifndef HSMTSTGEN_HPP_
+#define HSMTSTGEN_HPP_
+
+#include "hsm.hpp"
+#include <stdio.h>
+#include "hsmtst.hpp"
+
+class HsmTestGen : public Hsm {
+    int myFoo;
+    unsigned char currId; // current state
+public:
+    enum { N_STATES = 6, N_SIGS = 8 };
+    static char const * const stateName[N_STATES];
+    HsmTestGen();
+    Msg const *topHndlr(Msg const *msg); // the whole machine
+    unsigned stateOf() const { return currId; }
+private:
+    void topEntry_();
+    void topExit_();
+    void s1Entry_();
+    void s1Exit_();
+    void s11Entry_();
+    void s11Exit_();
+    void s2Entry_();
+    void s2Exit_();
+    void s21Entry_();
+    void s21Exit_();
+    void s211Entry_();
+    void s211Exit_();
+};
+
+#endif // HSMTSTGEN_HPP_
@@ -0,0 +1,192 @@
+//
+// hsmtstt.cpp -- HsmTest of hsmtst.cpp on the compile-time HsmT engine.
+// It produces the same output as hsmtst.cpp for the same input.
+//
+
+#include "hsmtstt.hpp"
+
+#include <stdio.h>
+
+Msg const *HsmTestT::hndlr(TopState s, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        HSMTST_PRINT("top-INIT;");
+        stateStart<S1>(s);
+        return 0;
+    case ENTRY_EVT:
+        HSMTST_PRINT("top-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        HSMTST_PRINT("top-EXIT;");
+        return 0;
+    case E_SIG:
+        HSMTST_PRINT("top-E;");
+        stateTran<S211>(s);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *HsmTestT::hndlr(S1 s, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        HSMTST_PRINT("s1-INIT;");
+        stateStart<S11>(s);
+        return 0;
+    case ENTRY_EVT:
+        HSMTST_PRINT("s1-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        HSMTST_PRINT("s1-EXIT;");
+        return 0;
+    case A_SIG:
+        HSMTST_PRINT("s1-A;");
+        stateTran<S1>(s);
+        return 0;
+    case B_SIG:
+        HSMTST_PRINT("s1-B;");
+        stateTran<S11>(s);
+        return 0;
+    case C_SIG:
+        HSMTST_PRINT("s1-C;");
+        stateTran<S2>(s);
+        return 0;
+    case D_SIG:
+        HSMTST_PRINT("s1-D;");
+        stateTran<TopState>(s);
+        return 0;
+    case F_SIG:
+        HSMTST_PRINT("s1-F;");
+        stateTran<S211>(s);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *HsmTestT::hndlr(S11 s, Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        HSMTST_PRINT("s11-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        HSMTST_PRINT("s11-EXIT;");
+        return 0;
+    case G_SIG:
+        HSMTST_PRINT("s11-G;");
+        stateTran<S211>(s);
+        return 0;
+    case H_SIG:
+        if (myFoo) {
+            HSMTST_PRINT("s11-H;");
+            myFoo = 0;
+            return 0;
+        }
+        break;
+    }
+    return msg;
+}
+
+Msg const *HsmTestT::hndlr(S2 s, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        HSMTST_PRINT("s2-INIT;");
+        stateStart<S21>(s);
+        return 0;
+    case ENTRY_EVT:
+        HSMTST_PRINT("s2-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        HSMTST_PRINT("s2-EXIT;");
+        return 0;
+    case C_SIG:
+        HSMTST_PRINT("s2-C;");
+        stateTran<S1>(s);
+        return 0;
+    case F_SIG:
+        HSMTST_PRINT("s2-F;");
+        stateTran<S11>(s);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *HsmTestT::hndlr(S21 s, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        HSMTST_PRINT("s21-INIT;");
+        stateStart<S211>(s);
+        return 0;
+    case ENTRY_EVT:
+        HSMTST_PRINT("s21-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        HSMTST_PRINT("s21-EXIT;");
+        return 0;
+    case B_SIG:
+        HSMTST_PRINT("s21-B;");
+        stateTran<S211>(s);
+        return 0;
+    case H_SIG:
+        if (!myFoo) {
+            HSMTST_PRINT("s21-H;");
+            myFoo = 1;
+            stateTran<S21>(s);
+            return 0;
+        }
+        break;
+    }
+    return msg;
+}
+
+Msg const *HsmTestT::hndlr(S211 s, Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        HSMTST_PRINT("s211-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        HSMTST_PRINT("s211-EXIT;");
+        return 0;
+    case D_SIG:
+        HSMTST_PRINT("s211-D;");
+        stateTran<S21>(s);
+        return 0;
+    case G_SIG:
+        HSMTST_PRINT("s211-G;");
+        stateTran<TopState>(s);
+        return 0;
+    }
+    return msg;
+}
+
+HsmTestT::HsmTestT()
+  : HsmT<HsmTestT>("HsmTestT")
+{
+    myFoo = 0;
+}
+
+#ifndef HSMTST_NO_MAIN
+int main() {
+    static Msg const msg[] = {
+        { A_SIG }, { B_SIG }, { C_SIG }, { D_SIG },
+        { E_SIG }, { F_SIG }, { G_SIG } ,{ H_SIG }
+    };
+    HsmTestT hsmTest;
+
+    printf("Events:\n"
+        "a-h for triggering events\n"
+        "x to exit\n\n");
+
+    hsmTest.onStart();
+    for (;;) {
+        int c;
+        printf("\nEvent<-");
+        c = getc(stdin);
+        getc(stdin);
+        if (c < 'a' || 'h' < c) {
+            break;
+        }
+        hsmTest.onEvent(&msg[c - 'a']);
+    }
+    return 0;
+}
+#endif // HSMTST_NO_MAIN
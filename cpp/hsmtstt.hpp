@@ -0,0 +1,28 @@
+//
+// hsmtstt.hpp -- HsmTest state machine on the compile-time HsmT engine
+//
+#ifndef HSMTSTT_HPP_
+#define HSMTSTT_HPP_
+
+#include "hsmt.hpp"
+#include "hsmtst.hpp" // HsmTestEvents, HSMTST_PRINT
+
+struct S1   : SubstateOf<TopState> {};
+struct S11  :   SubstateOf<S1> {};
+struct S2   : SubstateOf<TopState> {};
+struct S21  :   SubstateOf<S2> {};
+struct S211 :     SubstateOf<S21> {};
+
+class HsmTestT : public HsmT<HsmTestT> {
+    int myFoo;
+public:
+    HsmTestT();
+    Msg const *hndlr(TopState s, Msg const *msg);
+    Msg const *hndlr(S1 s, Msg const *msg);
+    Msg const *hndlr(S11 s, Msg const *msg);
+    Msg const *hndlr(S2 s, Msg const *msg);
+    Msg const *hndlr(S21 s, Msg const *msg);
+    Msg const *hndlr(S211 s, Msg const *msg);
+};
+
+#endif // HSMTSTT_HPP_
@@ -0,0 +1,286 @@
+//
+// Keyboard with two orthogonal regions: caps lock and num lock. The state
+// "on" is an AND-state, every key goes to both of its regions, and only
+// the events the regions ignore go up to "on" and the top. The same
+// events are then sent to a keyboard with the regions running in parallel
+// on a RegionPool, which must end with the same counts, and at last to
+// two keyboards sharing the pool from two threads.
+//
+// Build:
+// g++ keyboard.cpp region.cpp hsm.cpp -o keyboard -pthread
+//
+#include "region.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+
+enum KeyboardEvents {
+    CAPS_SIG, NUM_SIG, KEY_SIG, RESET_SIG, UNPLUG_SIG, PLUG_SIG
+};
+
+static bool l_quiet;        // no output of the parallel keyboard
+#define KBD_PRINT(str_) (l_quiet ? (void)0 : (void)printf(str_))
+
+class CapsLock : public Region {
+    State lower, upper;
+public:
+    unsigned nLower, nUpper; // # of keys typed in lower and upper case
+    CapsLock();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *lowerHndlr(Msg const *msg);
+    Msg const *upperHndlr(Msg const *msg);
+};
+
+class NumLock : public Region {
+    State digits, arrows;
+public:
+    unsigned nDigits, nArrows; // # of keys typed as digits and arrows
+    NumLock();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *digitsHndlr(Msg const *msg);
+    Msg const *arrowsHndlr(Msg const *msg);
+};
+
+class Keyboard : public Hsm {
+    State off, on;
+public:
+    CapsLock caps;
+    NumLock num;
+    Keyboard(RegionRunner *runner);
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *offHndlr(Msg const *msg);
+    Msg const *onHndlr(Msg const *msg);
+};
+
+Msg const *CapsLock::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        KBD_PRINT("caps-INIT;");
+        STATE_START(&lower);
+        return 0;
+    case EXIT_EVT:
+        KBD_PRINT("caps-EXIT;");
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *CapsLock::lowerHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        KBD_PRINT("lower-ENTRY;");
+        return 0;
+    case CAPS_SIG:
+        STATE_TRAN(&upper);
+        return 0;
+    case KEY_SIG:
+        ++nLower;
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *CapsLock::upperHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        KBD_PRINT("upper-ENTRY;");
+        return 0;
+    case CAPS_SIG:
+        STATE_TRAN(&lower);
+        return 0;
+    case KEY_SIG:
+        ++nUpper;
+        return 0;
+    }
+    return msg;
+}
+
+CapsLock::CapsLock()
+  : Region("CapsLock",    static_cast<EvtHndlr>(&CapsLock::topHndlr)),
+    lower("lower", &top, static_cast<EvtHndlr>(&CapsLock::lowerHndlr)),
+    upper("upper", &top, static_cast<EvtHndlr>(&CapsLock::upperHndlr)),
+    nLower(0), nUpper(0)
+{
+    STATE_HANDLES(&lower, CAPS_SIG); // for HSM_SIG_TABLES
+    STATE_HANDLES(&lower, KEY_SIG);
+    STATE_HANDLES(&upper, CAPS_SIG);
+    STATE_HANDLES(&upper, KEY_SIG);
+}
+
+Msg const *NumLock::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        KBD_PRINT("num-INIT;");
+        STATE_START(&digits);
+        return 0;
+    case EXIT_EVT:
+        KBD_PRINT("num-EXIT;");
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *NumLock::digitsHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        KBD_PRINT("digits-ENTRY;");
+        return 0;
+    case NUM_SIG:
+        STATE_TRAN(&arrows);
+        return 0;
+    case KEY_SIG:
+        ++nDigits;
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *NumLock::arrowsHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        KBD_PRINT("arrows-ENTRY;");
+        return 0;
+    case NUM_SIG:
+        STATE_TRAN(&digits);
+        return 0;
+    case KEY_SIG:
+        ++nArrows;
+        return 0;
+    }
+    return msg;
+}
+
+NumLock::NumLock()
+  : Region("NumLock",      static_cast<EvtHndlr>(&NumLock::topHndlr)),
+    digits("digits", &top, static_cast<EvtHndlr>(&NumLock::digitsHndlr)),
+    arrows("arrows", &top, static_cast<EvtHndlr>(&NumLock::arrowsHndlr)),
+    nDigits(0), nArrows(0)
+{
+    STATE_HANDLES(&digits, NUM_SIG); // for HSM_SIG_TABLES
+    STATE_HANDLES(&digits, KEY_SIG);
+    STATE_HANDLES(&arrows, NUM_SIG);
+    STATE_HANDLES(&arrows, KEY_SIG);
+}
+
+Msg const *Keyboard::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        STATE_START(&on);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Keyboard::offHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        KBD_PRINT("off-ENTRY;");
+        return 0;
+    case PLUG_SIG:
+        STATE_TRAN(&on);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Keyboard::onHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        KBD_PRINT("on-ENTRY;");
+        return 0;
+    case EXIT_EVT:
+        KBD_PRINT("on-EXIT;");
+        return 0;
+    case RESET_SIG: // ignored by the regions
+        KBD_PRINT("on-RESET;");
+        STATE_TRAN(&on);
+        return 0;
+    case UNPLUG_SIG:
+        STATE_TRAN(&off);
+        return 0;
+    }
+    return msg;
+}
+
+Keyboard::Keyboard(RegionRunner *runner)
+  : Hsm("Keyboard",           static_cast<EvtHndlr>(&Keyboard::topHndlr)),
+    off("off", &top,          static_cast<EvtHndlr>(&Keyboard::offHndlr)),
+    on("on",   &top,          static_cast<EvtHndlr>(&Keyboard::onHndlr))
+{
+    STATE_REGION(&on, &caps, runner);
+    STATE_REGION(&on, &num, runner);
+    STATE_HANDLES(&off, PLUG_SIG); // for HSM_SIG_TABLES
+    STATE_HANDLES(&on, RESET_SIG);
+    STATE_HANDLES(&on, UNPLUG_SIG);
+}
+
+static Msg const keyboardMsg[] = {
+    { CAPS_SIG }, { NUM_SIG }, { KEY_SIG },
+    { RESET_SIG }, { UNPLUG_SIG }, { PLUG_SIG }
+};
+
+static char const *const sigName[] = {
+    "CAPS", "NUM", "KEY", "RESET", "UNPLUG", "PLUG"
+};
+
+// events of the demo, then random ones......................................
+static void run(Keyboard *kbd, unsigned nEvt) {
+    static Event const demo[] = {
+        KEY_SIG, CAPS_SIG, KEY_SIG, NUM_SIG, KEY_SIG, RESET_SIG, KEY_SIG,
+        UNPLUG_SIG, KEY_SIG, PLUG_SIG, CAPS_SIG, KEY_SIG
+    };
+    unsigned rnd = 1;
+    kbd->onStart();
+    KBD_PRINT("\n");
+    for (unsigned i = 0; i < nEvt; ++i) {
+        Event e;
+        if (i < sizeof(demo) / sizeof(demo[0])) {
+            e = demo[i];
+            if (!l_quiet) {
+                printf("%s: ", sigName[e]);
+            }
+        }
+        else {
+            if (!l_quiet) { // written only by the first keyboard
+                l_quiet = true;
+            }
+            rnd = rnd * 1103515245U + 12345U;
+            e = (Event)((rnd >> 16) % 6);
+        }
+        kbd->onEvent(&keyboardMsg[e]);
+        KBD_PRINT("\n");
+    }
+}
+
+static bool sameCounts(Keyboard const *a, Keyboard const *b) {
+    return a->caps.nLower == b->caps.nLower
+           && a->caps.nUpper == b->caps.nUpper
+           && a->num.nDigits == b->num.nDigits
+           && a->num.nArrows == b->num.nArrows;
+}
+
+int main() {
+    Keyboard kbd(0);        // the regions run one after another
+    run(&kbd, 100000);
+
+    RegionPool pool(1);     // a worker thread and the dispatching thread
+    Keyboard kbdPar(&pool);
+    run(&kbdPar, 100000);
+
+    printf("lower %u, upper %u, digits %u, arrows %u\n",
+           kbd.caps.nLower, kbd.caps.nUpper,
+           kbd.num.nDigits, kbd.num.nArrows);
+    assert(sameCounts(&kbd, &kbdPar));
+    printf("the same with the regions in parallel\n");
+
+    Keyboard kbdA(&pool);   // the pool runs an event of one at a time
+    Keyboard kbdB(&pool);
+    l_quiet = true;         // before the threads, which only read it
+    std::thread a(run, &kbdA, 100000);
+    std::thread b(run, &kbdB, 100000);
+    a.join();
+    b.join();
+    assert(sameCounts(&kbd, &kbdA) && sameCounts(&kbd, &kbdB));
+    printf("the same with two keyboards sharing the pool\n");
+    return 0;
+}
@@ -1,3 +1,37 @@
 g++ watch.cpp hsm.cpp -o watch -pedantic -Wall -Wextra
 
 g++ hsmtst.cpp hsm.cpp -o hsmtst -pedantic -Wall -Wextra
+
+g++ -std=c++17 hsmtstt.cpp -o hsmtstt -pedantic -Wall -Wextra
+
+g++ -O2 -DHSMTST_QUIET -DHSMTST_NO_MAIN schedbench.cpp sched.cpp active.cpp evtpool.cpp hsmtst.cpp hsm.cpp -o schedbench -pedantic -Wall -Wextra -pthread
+
+g++ -O2 hsmbench.cpp hsm.cpp -o hsmbench -pedantic -Wall -Wextra
+
+g++ tracedec.cpp -o tracedec -pedantic -Wall -Wextra
+
+g++ -O2 watchsoa.cpp hsmsoa.cpp -o watchsoa -pedantic -Wall -Wextra
+
+g++ -DWATCH_NO_MAIN watchao.cpp watch.cpp active.cpp evtpool.cpp sched.cpp hsm.cpp -o watchao -pedantic -Wall -Wextra -pthread
+
+g++ timers.cpp timewheel.cpp active.cpp evtpool.cpp sched.cpp hsm.cpp -o timers -pedantic -Wall -Wextra -pthread
+
+g++ -O2 fanout.cpp pubsub.cpp sched.cpp active.cpp evtpool.cpp hsm.cpp -o fanout -pedantic -Wall -Wextra -pthread
+
+g++ -O2 -DWATCH_QUIET -DWATCH_NO_MAIN watchsnap.cpp watch.cpp hsmsnap.cpp hsm.cpp -o watchsnap -pedantic -Wall -Wextra
+
+g++ -O2 -DHSMTST_QUIET -DHSMTST_NO_MAIN evtreplay.cpp evtlog.cpp hsmtst.cpp hsm.cpp -o evtreplay -pedantic -Wall -Wextra -pthread
+
+g++ keyboard.cpp region.cpp hsm.cpp -o keyboard -pedantic -Wall -Wextra -pthread
+
+g++ hsmgen.cpp -o hsmgen -pedantic -Wall -Wextra
+
+hsmgen hsmtst.hsm hsmtstgen
+
+g++ hsmtstg.cpp hsmtstgen.cpp hsm.cpp -o hsmtstg -pedantic -Wall -Wextra
+
+g++ -O2 reqarena.cpp hsm.cpp -o reqarena -pedantic -Wall -Wextra
+
+g++ -std=c++20 -DWATCH_NO_MAIN watchco.cpp watch.cpp hsmco.cpp active.cpp evtpool.cpp sched.cpp hsm.cpp -o watchco -pedantic -Wall -Wextra -pthread
+
+g++ -O2 -DREACTOR_URING echosrv.cpp reactor.cpp hsm.cpp -o echosrv -pedantic -Wall -Wextra
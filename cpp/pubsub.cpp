@@ -0,0 +1,115 @@
+//
+// pubsub.cpp -- Publish-subscribe event delivery to active objects
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include "evtpool.hpp"
+#include "pubsub.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static unsigned lsb_(unsigned long long bits) { // index of the lowest 1-bit
+    unsigned long idx;
+    _BitScanForward64(&idx, bits);
+    return (unsigned)idx;
+}
+#else
+#define lsb_(bits_) ((unsigned)__builtin_ctzll(bits_))
+#endif
+
+// PubSub Ctor................................................................
+PubSub::PubSub(Event sigs, unsigned max)
+  : nLost(0), aos(new Active *[max]), nActive(0), maxActive(max),
+    maxSig(sigs), nWords((max + 63) / 64), nSummaries((nWords + 63) / 64)
+{
+    assert(sigs > 0);
+    sets = new std::atomic<Bits>[(unsigned)sigs * nWords];
+    summaries = new std::atomic<Bits>[(unsigned)sigs * nSummaries];
+    for (unsigned i = 0; i < (unsigned)sigs * nWords; ++i) {
+        sets[i].store(0, std::memory_order_relaxed);
+    }
+    for (unsigned i = 0; i < (unsigned)sigs * nSummaries; ++i) {
+        summaries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+PubSub::~PubSub() {
+    delete[] summaries;
+    delete[] sets;
+    delete[] aos;
+}
+
+// add a subscriber (before it subscribes to any signal)......................
+unsigned PubSub::add(Active *ao) {
+    assert(nActive < maxActive);
+    aos[nActive] = ao;
+    return nActive++;
+}
+
+// subscribe to a signal......................................................
+void PubSub::subscribe(unsigned id, Event sig) {
+    assert(id < nActive && 0 <= sig && sig < maxSig);
+    set_(sig)[id / 64].fetch_or(1ULL << (id % 64), std::memory_order_release);
+    summary_(sig)[id / 4096].fetch_or(1ULL << (id / 64 % 64),
+                                      std::memory_order_release);
+}
+
+// unsubscribe from a signal (the summary bit stays set)......................
+void PubSub::unsubscribe(unsigned id, Event sig) {
+    assert(id < nActive && 0 <= sig && sig < maxSig);
+    set_(sig)[id / 64].fetch_and(~(1ULL << (id % 64)),
+                                 std::memory_order_release);
+}
+
+// post the event to all its subscribers......................................
+unsigned PubSub::publish(Msg const *msg) {
+    assert(0 <= msg->evt && msg->evt < maxSig);
+    std::atomic<Bits> const *set = set_(msg->evt);
+    std::atomic<Bits> const *summary = summary_(msg->evt);
+    unsigned n = 0;
+    evtRef(msg); // don't let the first subscribers recycle the event
+    for (unsigned s = 0; s < nSummaries; ++s) {
+        Bits words = summary[s].load(std::memory_order_acquire);
+        while (words != 0) {
+            unsigned w = s * 64 + lsb_(words);
+            words &= words - 1;
+            Bits bits = set[w].load(std::memory_order_acquire);
+            while (bits != 0) {
+                Active *ao = aos[w * 64 + lsb_(bits)];
+                bits &= bits - 1;
+                if (ao->post(msg)) {
+                    ++n;
+                }
+                else {
+                    nLost.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    evtGc(msg); // recycles the event if nobody took it
+    return n;
+}
@@ -0,0 +1,66 @@
+//
+// pubsub.hpp -- Publish-subscribe event delivery to active objects
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef PUBSUB_HPP_
+#define PUBSUB_HPP_
+
+#include "active.hpp"
+
+// PubSub delivers a published event to every active object subscribed to
+// its signal. The subscribers of a signal form a bitset indexed by the
+// subscriber ids, with one more "summary" bit per 64 subscribers, so
+// publishing skips the empty parts of the bitset. The event is posted by
+// reference: all subscribers share one (pool) event.
+class PubSub {
+public:
+    PubSub(Event maxSig, unsigned maxActive); // signals 0..maxSig-1
+    ~PubSub();
+    unsigned add(Active *ao); // before publishing, returns the subscriber id
+    void subscribe(unsigned id, Event sig);   // any thread
+    void unsubscribe(unsigned id, Event sig); // any thread
+    unsigned publish(Msg const *msg); // any thread, returns # of posts
+    std::atomic<unsigned> nLost;      // # of posts lost to full queues
+private:
+    typedef unsigned long long Bits;
+    std::atomic<Bits> *set_(Event sig) const {
+        return &sets[(unsigned)sig * nWords];
+    }
+    std::atomic<Bits> *summary_(Event sig) const {
+        return &summaries[(unsigned)sig * nSummaries];
+    }
+    Active **aos;                 // subscribers by id
+    unsigned nActive;             // # of subscribers added
+    unsigned maxActive;
+    Event maxSig;
+    unsigned nWords;              // # of Bits words per signal
+    unsigned nSummaries;          // # of summary words per signal
+    std::atomic<Bits> *sets;      // subscriber bits of all signals
+    std::atomic<Bits> *summaries; // bit i set if word i might be non-zero
+};
+
+#endif // PUBSUB_HPP_
@@ -0,0 +1,396 @@
+//
+// reactor.cpp -- I/O reactor implementation (Linux)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include "reactor.hpp"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#ifdef REACTOR_URING
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// Reactor Ctor...............................................................
+Reactor::Reactor(unsigned n, bool uring)
+  : srcs(new IoSrc[n]), maxSrcs(n),
+    bufs((char *)aligned_alloc(4096, ((size_t)n * REACTOR_BUF_SIZE + 4095)
+                                     & ~(size_t)4095)),
+    freeList(0), removed(0), epollFd(-1), ringFd(-1)
+{
+    assert(n != 0 && bufs != 0);
+    for (unsigned i = n; i-- != 0; ) { // the first source first
+        srcs[i].fd = -1;
+        srcs[i].hsm = 0;
+        srcs[i].buf = &bufs[(size_t)i * REACTOR_BUF_SIZE];
+        srcs[i].pending = false;
+        srcs[i].next = freeList;
+        freeList = &srcs[i];
+    }
+#ifdef REACTOR_URING
+    if (uring && uringInit_()) {
+        return;
+    }
+#else
+    (void)uring;
+#endif
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epollFd >= 0);
+}
+
+// Reactor Xtor...............................................................
+Reactor::~Reactor() {
+#ifdef REACTOR_URING
+    if (ringFd >= 0) {
+        munmap(sqes, sqesLen);
+        if (cqMap != sqMap) {
+            munmap(cqMap, cqMapLen);
+        }
+        munmap(sqMap, sqMapLen);
+        close(ringFd); // cancels the reads still submitted
+    }
+#endif
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+    free(bufs);
+    delete[] srcs;
+}
+
+// add a source reading the descriptor........................................
+IoSrc *Reactor::addReader(int fd, Hsm *hsm, Event sig) {
+    return add_(fd, hsm, sig, true);
+}
+
+// add a source only reporting that the descriptor is readable...............
+IoSrc *Reactor::addWatcher(int fd, Hsm *hsm, Event sig) {
+    return add_(fd, hsm, sig, false);
+}
+
+// take a free source for the descriptor......................................
+IoSrc *Reactor::add_(int fd, Hsm *hsm, Event sig, bool reader) {
+    IoSrc *src = freeList;
+    if (src == 0) {
+        return 0;
+    }
+    freeList = src->next;
+    src->fd = fd;
+    src->hsm = hsm;
+    src->sig = sig;
+    src->polling = !reader;
+    if (!reader) {
+        src->buf = 0;
+    }
+    else if (src->buf == 0) { // was a watcher
+        src->buf = &bufs[(size_t)(src - srcs) * REACTOR_BUF_SIZE];
+    }
+#ifdef REACTOR_URING
+    if (ringFd >= 0) {
+        submit_(src);
+        return src;
+    }
+#endif
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = src;
+    int r = epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    assert(r == 0);
+    (void)r;
+    return src;
+}
+
+// remove a source, recycled when the kernel is done with its buffer........
+void Reactor::remove(IoSrc *src) {
+    assert(src->hsm != 0);
+    src->hsm = 0;
+#ifdef REACTOR_URING
+    if (ringFd >= 0) {
+        if (src->pending) {
+            io_uring_sqe *sqe = sqe_();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = (unsigned long long)(size_t)src;
+            sqe->user_data = 0; // completion ignored
+        }
+    }
+    else
+#endif
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, src->fd, 0);
+    }
+    src->next = removed;
+    removed = src;
+}
+
+// dispatch the event of a source to its machine..............................
+inline void Reactor::dispatch_(IoSrc *src, int len) {
+    IoEvt e;
+    e.evt = src->sig;
+    e.src = src;
+    e.data = src->buf;
+    e.len = len;
+    src->hsm->onEvent(&e);
+}
+
+// recycle the removed sources the kernel is done with........................
+void Reactor::free_() {
+    IoSrc **link = &removed;
+    while (*link != 0) {
+        IoSrc *src = *link;
+        if (src->pending) { // the cancelled read not completed yet?
+            link = &src->next;
+        }
+        else {
+            *link = src->next;
+            src->fd = -1;
+            src->next = freeList;
+            freeList = src;
+        }
+    }
+}
+
+// wait for the sources and dispatch their events.............................
+unsigned Reactor::poll(int timeoutMs) {
+    unsigned n;
+#ifdef REACTOR_URING
+    if (ringFd >= 0) {
+        n = pollUring_(timeoutMs);
+    }
+    else
+#endif
+    {
+        n = pollEpoll_(timeoutMs);
+    }
+    if (removed != 0) {
+        free_();
+    }
+    return n;
+}
+
+// wait with epoll and read the ready sources.................................
+unsigned Reactor::pollEpoll_(int timeoutMs) {
+    epoll_event ev[REACTOR_BATCH];
+    int nEv = epoll_wait(epollFd, ev, REACTOR_BATCH, timeoutMs);
+    unsigned n = 0;
+    for (int i = 0; i < nEv; ++i) {
+        IoSrc *src = (IoSrc *)ev[i].data.ptr;
+        if (src->hsm == 0) { // removed by an event before?
+            continue;
+        }
+        if (src->buf == 0) { // watcher?
+            dispatch_(src, 0);
+        }
+        else {
+            ssize_t len = read(src->fd, src->buf, REACTOR_BUF_SIZE);
+            if (len < 0) {
+                if (errno == EAGAIN || errno == EINTR) {
+                    continue;
+                }
+                len = -errno;
+            }
+            dispatch_(src, (int)len);
+        }
+        ++n;
+    }
+    return n;
+}
+
+#ifdef REACTOR_URING
+// set up the rings and register the buffers, false if not supported........
+bool Reactor::uringInit_() {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    unsigned cq = 512; // at least the # of submission entries
+    while (cq < 2 * maxSrcs && cq < 65536) {
+        cq <<= 1; // room for a completion of every source
+    }
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = cq;
+    int fd = (int)syscall(__NR_io_uring_setup, 256, &p);
+    if (fd < 0) {
+        return false;
+    }
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0
+        || (p.features & IORING_FEAT_EXT_ARG) == 0) // for the timeout
+    {
+        close(fd);
+        return false;
+    }
+    sqMapLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqMapLen = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (cqMapLen > sqMapLen) {
+        sqMapLen = cqMapLen; // one mapping of both rings
+    }
+    cqMapLen = sqMapLen;
+    sqMap = mmap(0, sqMapLen, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    sqesLen = p.sq_entries * sizeof(io_uring_sqe);
+    void *s = (sqMap != MAP_FAILED)
+              ? mmap(0, sqesLen, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES)
+              : MAP_FAILED;
+    if (s == MAP_FAILED) {
+        if (sqMap != MAP_FAILED) {
+            munmap(sqMap, sqMapLen);
+        }
+        close(fd);
+        return false;
+    }
+    cqMap = sqMap;
+    char *sq = (char *)sqMap;
+    sqHead = (unsigned *)(sq + p.sq_off.head);
+    sqTail = (unsigned *)(sq + p.sq_off.tail);
+    sqArray = (unsigned *)(sq + p.sq_off.array);
+    sqMask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    sqEntries = p.sq_entries;
+    sqLocalTail = *sqTail;
+    nToSubmit = 0;
+    sqes = (io_uring_sqe *)s;
+    cqHead = (unsigned *)(sq + p.cq_off.head);
+    cqTail = (unsigned *)(sq + p.cq_off.tail);
+    cqMask = *(unsigned *)(sq + p.cq_off.ring_mask);
+    cqes = (io_uring_cqe *)(sq + p.cq_off.cqes);
+
+    iovec iov; // all the buffers as one registered buffer
+    iov.iov_base = bufs;
+    iov.iov_len = (size_t)maxSrcs * REACTOR_BUF_SIZE;
+    fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                    &iov, 1) == 0; // else plain reads (memlock limit)
+    ringFd = fd;
+    return true;
+}
+
+// take the next submission entry, submit the full ring first..............
+io_uring_sqe *Reactor::sqe_() {
+    if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+        __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+        int r = (int)syscall(__NR_io_uring_enter, ringFd, nToSubmit, 0, 0,
+                             0, 0);
+        assert(r >= 0);
+        nToSubmit -= (unsigned)r;
+    }
+    unsigned idx = sqLocalTail & sqMask;
+    io_uring_sqe *sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[idx] = idx;
+    ++sqLocalTail;
+    ++nToSubmit;
+    return sqe;
+}
+
+// submit the read of a reader or the poll of a watcher.....................
+void Reactor::submit_(IoSrc *src) {
+    io_uring_sqe *sqe = sqe_();
+    sqe->fd = src->fd;
+    sqe->user_data = (unsigned long long)(size_t)src;
+    if (src->polling) {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = POLLIN;
+    }
+    else {
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->addr = (unsigned long long)(size_t)src->buf;
+        sqe->len = REACTOR_BUF_SIZE;
+        sqe->off = (unsigned long long)-1; // the file position
+        sqe->buf_index = 0;
+    }
+    src->pending = true;
+}
+
+// submit, wait for the completions and dispatch them.......................
+unsigned Reactor::pollUring_(int timeoutMs) {
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (long long)(timeoutMs % 1000) * 1000000;
+        arg.ts = (unsigned long long)(size_t)&ts;
+    }
+    __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) { // none yet?
+        int r = (int)syscall(__NR_io_uring_enter, ringFd, nToSubmit,
+                             timeoutMs != 0 ? 1 : 0,
+                             IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                             &arg, sizeof(arg));
+        if (r >= 0) {
+            nToSubmit -= (unsigned)r;
+        }
+        else {
+            assert(errno == ETIME || errno == EINTR || errno == EBUSY);
+        }
+    }
+    else if (nToSubmit != 0) {
+        int r = (int)syscall(__NR_io_uring_enter, ringFd, nToSubmit, 0, 0,
+                             0, 0);
+        if (r >= 0) {
+            nToSubmit -= (unsigned)r;
+        }
+    }
+    unsigned n = 0;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail && n < REACTOR_BATCH; ++head) {
+        io_uring_cqe const *cqe = &cqes[head & cqMask];
+        IoSrc *src = (IoSrc *)(size_t)cqe->user_data;
+        int res = cqe->res;
+        if (src == 0) { // completion of a cancel
+            continue;
+        }
+        src->pending = false;
+        if (src->hsm == 0) { // removed, the read is cancelled or done
+            continue;
+        }
+        if (res == -EAGAIN || res == -EINTR) { // non-blocking descriptor?
+            src->polling = true; // wait for the data, then read it
+        }
+        else if (src->polling && src->buf != 0) { // reader ready?
+            src->polling = false;
+        }
+        else {
+            dispatch_(src, (src->buf == 0 && res > 0) ? 0 : res);
+            ++n;
+            if (src->hsm == 0 || (src->buf != 0 && res <= 0)) {
+                continue; // removed by its machine, or at the end
+            }
+        }
+        submit_(src); // the next read or poll
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    return n;
+}
+#endif
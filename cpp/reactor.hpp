@@ -0,0 +1,113 @@
+//
+// reactor.hpp -- I/O reactor dispatching file descriptor events (Linux)
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef REACTOR_HPP_
+#define REACTOR_HPP_
+
+#include "hsm.hpp"
+
+#ifndef REACTOR_BUF_SIZE
+#define REACTOR_BUF_SIZE 1024 // size of the read buffer of a source
+#endif
+#define REACTOR_BATCH 256     // max # of I/O events taken in one go
+
+struct io_uring_sqe; // forward declarations
+struct io_uring_cqe;
+
+// IoSrc is a file descriptor of a machine, one of the sources of a
+// Reactor. A reader reads the data of the descriptor into the buffer of
+// the source, a watcher only reports that the descriptor is readable
+// (for example a listening socket).
+class IoSrc {
+public:
+    int fd;
+    Hsm *hsm;                     // machine of the source (0 if removed)
+    Event sig;                    // signal of its IoEvt
+private:
+    char *buf;                    // read buffer (0 for a watcher)
+    IoSrc *next;                  // next free or removed source
+    bool pending;                 // read or poll submitted to io_uring
+    bool polling;                 // reader waiting for the readiness
+    friend class Reactor;
+};
+
+// IoEvt is the event of a source, dispatched to its machine. The data is
+// not copied: it stays in the buffer of the source, valid only while the
+// event is dispatched. The event of a watcher has no data and len 0.
+struct IoEvt : public Msg {
+    IoSrc *src;
+    char const *data;             // data read (0 for a watcher)
+    int len;                      // # of bytes read, 0 at the end, -errno
+};
+
+// Reactor waits for the sources of many machines in one thread and
+// dispatches their events to the machines in that thread. A reader at the
+// end of its data (len <= 0) must be removed by its machine. With
+// REACTOR_URING the reads are submitted to io_uring into buffers
+// registered with the kernel, which reads straight into them. Without it,
+// or if the kernel does not support io_uring, the sources are waited for
+// with epoll and read when ready.
+class Reactor {
+public:
+    Reactor(unsigned maxSrcs, bool uring = true); // ctor, # of sources
+    ~Reactor();                   // xtor, the descriptors are not closed
+    IoSrc *addReader(int fd, Hsm *hsm, Event sig); // 0 if none is free
+    IoSrc *addWatcher(int fd, Hsm *hsm, Event sig);
+    void remove(IoSrc *src);      // also in a handler, before the close
+    unsigned poll(int timeoutMs); // # of events dispatched, -1 waits
+    bool isUring() const { return ringFd >= 0; }
+private:
+    IoSrc *add_(int fd, Hsm *hsm, Event sig, bool reader);
+    void dispatch_(IoSrc *src, int len);
+    void free_();                 // recycle the removed sources
+    unsigned pollEpoll_(int timeoutMs);
+    IoSrc *srcs;                  // all the sources
+    unsigned maxSrcs;
+    char *bufs;                   // their buffers, one block
+    IoSrc *freeList;
+    IoSrc *removed;               // removed, to be recycled
+    int epollFd;
+    int ringFd;                   // io_uring (-1 if not used)
+#ifdef REACTOR_URING
+    bool uringInit_();
+    io_uring_sqe *sqe_();         // next submission entry
+    void submit_(IoSrc *src);     // submit a read or a poll
+    unsigned pollUring_(int timeoutMs);
+    unsigned *sqHead, *sqTail, *sqArray, sqMask, sqEntries;
+    unsigned sqLocalTail;         // tail including the unsubmitted entries
+    unsigned nToSubmit;
+    io_uring_sqe *sqes;
+    unsigned *cqHead, *cqTail, cqMask;
+    io_uring_cqe *cqes;
+    void *sqMap, *cqMap;          // the mapped rings
+    unsigned long sqMapLen, cqMapLen, sqesLen;
+    bool fixed;                   // the buffers are registered
+#endif
+};
+
+#endif // REACTOR_HPP_
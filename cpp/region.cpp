@@ -0,0 +1,128 @@
+//
+// region.cpp -- Running independent orthogonal regions in parallel
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include "region.hpp"
+
+// The pools whose regions the current thread is running, innermost first.
+struct InPool {
+    RegionPool *pool;
+    InPool const *outer;
+};
+static thread_local InPool const *l_inPool;
+
+// dispatch the event to a region of the pool................................
+static bool dispatchIn_(RegionPool *pool, Region *region, Msg const *m) {
+    InPool in = { pool, l_inPool };
+    l_inPool = &in;
+    bool c = region->dispatch(m);
+    l_inPool = in.outer;
+    return c;
+}
+
+// RegionPool Ctor............................................................
+RegionPool::RegionPool(unsigned n)
+  : threads(new std::thread[n]), nThreads(n), job(0), msg(0), nJob(0),
+    nextJob(0), nDone(0), consumed(false), stopping(false)
+{
+    run = &RegionPool::run_;
+    for (unsigned i = 0; i < n; ++i) {
+        threads[i] = std::thread(&RegionPool::work_, this);
+    }
+}
+
+// RegionPool Xtor............................................................
+RegionPool::~RegionPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        start.notify_all();
+    }
+    for (unsigned i = 0; i < nThreads; ++i) {
+        threads[i].join();
+    }
+    delete[] threads;
+}
+
+// dispatch the event to n regions in parallel, true if any consumed it......
+bool RegionPool::run_(RegionRunner *me, Region * const *r, unsigned n,
+                      Msg const *m)
+{
+    RegionPool *pool = static_cast<RegionPool *>(me);
+    for (InPool const *in = l_inPool; in != 0; in = in->outer) {
+        if (in->pool == pool) { // nested in a region of this pool's job?
+            bool consumed = false;
+            for (unsigned i = 0; i < n; ++i) {
+                consumed = dispatchIn_(pool, r[i], m) || consumed;
+            }
+            return consumed;
+        }
+    }
+    std::lock_guard<std::mutex> caller(pool->runMutex); // one job at a time
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->job = r;
+    pool->msg = m;
+    pool->nJob = n;
+    pool->nextJob = 0;
+    pool->nDone = 0;
+    pool->consumed = false;
+    pool->start.notify_all();
+    while (pool->nextJob < pool->nJob) { // run regions in this thread too
+        Region *region = pool->job[pool->nextJob++];
+        lock.unlock();
+        bool c = dispatchIn_(pool, region, m);
+        lock.lock();
+        pool->consumed = pool->consumed || c;
+        ++pool->nDone;
+    }
+    while (pool->nDone != pool->nJob) {
+        pool->done.wait(lock);
+    }
+    return pool->consumed;
+}
+
+// run the regions taken from the current job.................................
+void RegionPool::work_() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        while (!stopping && nextJob == nJob) {
+            start.wait(lock);
+        }
+        if (stopping) {
+            return;
+        }
+        Region *region = job[nextJob++];
+        Msg const *m = msg;
+        lock.unlock();
+        bool c = dispatchIn_(this, region, m);
+        lock.lock();
+        consumed = consumed || c;
+        if (++nDone == nJob) {
+            done.notify_one();
+        }
+    }
+}
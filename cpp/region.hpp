@@ -0,0 +1,70 @@
+//
+// region.hpp -- Running independent orthogonal regions in parallel
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef REGION_HPP_
+#define REGION_HPP_
+
+#include "hsm.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// RegionPool runs the independent regions of an AND-state (declared with
+// the pool as their RegionRunner) in parallel: the thread dispatching the
+// event to the owner and the worker threads of the pool take the regions
+// one by one, and the owner continues when all of them are done. The
+// handlers of independent regions must not share any data.
+// The pool runs one event at a time: the machines dispatching events in
+// other threads (e.g., active objects on different Sched workers) wait for
+// it. A region with AND-states of its own, on the same pool, dispatches
+// to their regions one by one in its thread.
+class RegionPool : public RegionRunner {
+public:
+    RegionPool(unsigned nThreads); // ctor, # of worker threads
+    ~RegionPool();                 // xtor, joins the workers
+private:
+    static bool run_(RegionRunner *me, Region * const *r, unsigned n,
+                     Msg const *msg);
+    void work_();                  // the worker thread routine
+    std::thread *threads;
+    unsigned nThreads;
+    std::mutex runMutex;           // held by the one thread running a job
+    std::mutex mutex;              // protects all the members below
+    std::condition_variable start; // regions to run
+    std::condition_variable done;  // all the regions run
+    Region * const *job;           // regions to run
+    Msg const *msg;                // event to dispatch to them
+    unsigned nJob;                 // # of regions to run
+    unsigned nextJob;              // next region to take
+    unsigned nDone;                // # of regions run
+    bool consumed;                 // any region consumed the event
+    bool stopping;
+};
+
+#endif // REGION_HPP_
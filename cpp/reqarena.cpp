@@ -0,0 +1,155 @@
+//
+// Short-lived machines, one per request, created and destroyed at a high
+// rate: with new and delete, then from an HsmArena that restarts the
+// machines returned to it instead of constructing them again. Either way
+// a request is stopped when it is over, which exits its states.
+//
+// Build:
+// g++ -O2 reqarena.cpp hsm.cpp -o reqarena
+//
+// usage: reqarena [requests]
+//
+#include "hsmarena.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#define ARENA_LEN 256       // # of requests in progress at a time
+
+enum RequestEvents {
+    DATA_SIG, END_SIG, SENT_SIG
+};
+
+static Msg const requestMsg[] = {
+    { DATA_SIG }, { END_SIG }, { SENT_SIG }
+};
+
+static unsigned l_nLive;    // # of requests entered and not exited
+
+class Request : public Hsm {
+    State reading, replying, done;
+public:
+    unsigned nData;         // # of data received
+    Request();
+    bool isDone() { return STATE_CURR() == &done; }
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *readingHndlr(Msg const *msg);
+    Msg const *replyingHndlr(Msg const *msg);
+    Msg const *doneHndlr(Msg const *msg);
+};
+
+Msg const *Request::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        ++l_nLive;
+        return 0;
+    case EXIT_EVT:
+        --l_nLive;
+        return 0;
+    case START_EVT:
+        nData = 0; // here, not only in the ctor, for the arena
+        STATE_START(&reading);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Request::readingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case DATA_SIG:
+        ++nData;
+        return 0;
+    case END_SIG:
+        STATE_TRAN(&replying);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Request::replyingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case SENT_SIG:
+        STATE_TRAN(&done);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Request::doneHndlr(Msg const *msg) {
+    return msg;
+}
+
+Request::Request()
+  : Hsm("Request",              static_cast<EvtHndlr>(&Request::topHndlr)),
+    reading("reading", &top,    static_cast<EvtHndlr>(&Request::readingHndlr)),
+    replying("replying", &top,  static_cast<EvtHndlr>(&Request::replyingHndlr)),
+    done("done", &top,          static_cast<EvtHndlr>(&Request::doneHndlr)),
+    nData(0)
+{
+    STATE_HANDLES(&reading, DATA_SIG); // for HSM_SIG_TABLES
+    STATE_HANDLES(&reading, END_SIG);
+    STATE_HANDLES(&replying, SENT_SIG);
+}
+
+// serve a request, its # of data depends on the request number............
+static void serve(Request *req, unsigned long i) {
+    for (unsigned k = 0; k < 1 + i % 4; ++k) {
+        req->onEvent(&requestMsg[DATA_SIG]);
+    }
+    req->onEvent(&requestMsg[END_SIG]);
+    req->onEvent(&requestMsg[SENT_SIG]);
+    assert(req->isDone() && req->nData == 1 + i % 4);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long n = (argc > 1) ? strtoul(argv[1], 0, 10) : 2000000UL;
+    Request *live[ARENA_LEN] = { 0 };
+
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < n; ++i) {
+        Request *&req = live[i % ARENA_LEN];
+        if (req != 0) { // the oldest request is over
+            req->onStop();
+            delete req;
+        }
+        req = new Request;
+        req->onStart();
+        serve(req, i);
+    }
+    double nsNew = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - t0).count() / n;
+    for (unsigned i = 0; i < ARENA_LEN; ++i) {
+        live[i]->onStop();
+        delete live[i];
+        live[i] = 0;
+    }
+    assert(l_nLive == 0);
+
+    static HsmArena<Request>::Slot sto[ARENA_LEN];
+    static HsmArena<Request> arena; // one per thread
+    arena.init(sto, ARENA_LEN);
+    t0 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < n; ++i) {
+        Request *&req = live[i % ARENA_LEN];
+        if (req != 0) {
+            arena.put(req);
+        }
+        req = arena.get(); // started
+        assert(req != 0);
+        serve(req, i);
+    }
+    double nsArena = std::chrono::duration<double, std::nano>(
+                         std::chrono::steady_clock::now() - t0).count() / n;
+    assert(l_nLive == ARENA_LEN);
+    for (unsigned i = 0; i < ARENA_LEN; ++i) {
+        arena.put(live[i]); // exits the states
+    }
+    assert(l_nLive == 0);
+
+    printf("%lu requests: new/delete %.1f ns, arena %.1f ns per request\n",
+           n, nsNew, nsArena);
+    return 0;
+}
@@ -0,0 +1,219 @@
+//
+// sched.cpp -- Work-stealing scheduler of active objects
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include "sched.hpp"
+
+#define MAX_AO_BATCH  32     // max # of events dispatched per turn of an AO
+#define MAX_IDLE_SPIN 64     // # of failed searches before a worker sleeps
+
+static thread_local Sched const *l_sched; // Sched of the current worker
+static thread_local void *l_worker;       // the current worker
+
+// initialize the deque.......................................................
+void Sched::Deque::init(unsigned len) {
+    assert(len != 0 && (len & (len - 1)) == 0); // power of 2
+    buf = new std::atomic<Active *>[len];
+    mask = len - 1;
+    top.store(0, std::memory_order_relaxed);
+    bottom.store(0, std::memory_order_relaxed);
+}
+
+Sched::Deque::~Deque() {
+    delete[] buf;
+}
+
+// push a ready AO at the bottom (owner only).................................
+void Sched::Deque::push(Active *ao) {
+    long b = bottom.load(std::memory_order_relaxed);
+    assert(b - top.load(std::memory_order_acquire) <= mask); // not full
+    buf[b & mask].store(ao, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+// take the oldest ready AO from the top (any thread).........................
+Active *Sched::Deque::steal() {
+    long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long b = bottom.load(std::memory_order_acquire);
+    if (t < b) { // not empty?
+        Active *ao = buf[t & mask].load(std::memory_order_relaxed);
+        if (top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return ao;
+        }
+    }
+    return 0;
+}
+
+// check if the deque is empty (any thread)...................................
+bool Sched::Deque::isEmpty() const {
+    return bottom.load(std::memory_order_acquire)
+           <= top.load(std::memory_order_acquire);
+}
+
+// Sched Ctor.................................................................
+Sched::Sched(unsigned n, unsigned maxActive)
+  : workers(new Worker[n]), nWorkers(n),
+    injected(0), sleepers(0), running(false)
+{
+    unsigned len = 1;
+    while (len < maxActive) { // any worker might hold every AO
+        len <<= 1;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        workers[i].deque.init(len);
+        workers[i].victim = i + 1;
+    }
+}
+
+Sched::~Sched() {
+    assert(!running.load());
+    delete[] workers;
+}
+
+// start the worker threads...................................................
+void Sched::start() {
+    running.store(true);
+    for (unsigned i = 0; i < nWorkers; ++i) {
+        workers[i].thread = std::thread(&Sched::run_, this, &workers[i]);
+    }
+}
+
+// stop and join the worker threads (the ready AOs stay undispatched).........
+void Sched::stop() {
+    running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_all();
+    }
+    for (unsigned i = 0; i < nWorkers; ++i) {
+        workers[i].thread.join();
+    }
+}
+
+// make an AO ready (the caller has set ao->scheduled)........................
+void Sched::ready(Active *ao) {
+    if (l_sched == this) { // posted from one of the workers?
+        static_cast<Worker *>(l_worker)->deque.push(ao);
+    }
+    else {
+        Active *head = injected.load(std::memory_order_relaxed);
+        do {
+            ao->nextReady = head;
+        } while (!injected.compare_exchange_weak(head, ao,
+                     std::memory_order_release, std::memory_order_relaxed));
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) != 0) { // idle workers?
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+}
+
+// find a ready AO: own deque, then the injected AOs, then steal..............
+Active *Sched::find_(Worker *w) {
+    Active *ao = w->deque.steal();
+    if (ao != 0) {
+        return ao;
+    }
+    if (injected.load(std::memory_order_relaxed) != 0) {
+        ao = injected.exchange(0, std::memory_order_acquire); // take all
+        if (ao != 0) { // the list is newest first, reverse it
+            Active *oldest = 0;
+            while (ao != 0) {
+                Active *next = ao->nextReady;
+                ao->nextReady = oldest;
+                oldest = ao;
+                ao = next;
+            }
+            for (ao = oldest->nextReady; ao != 0; ) {
+                Active *next = ao->nextReady; // ao can be stolen once pushed
+                w->deque.push(ao);
+                ao = next;
+            }
+            return oldest;
+        }
+    }
+    if (nWorkers > 1) {
+        w->victim = w->victim * 1103515245U + 12345U;
+        unsigned v = (w->victim >> 16) % nWorkers;
+        for (unsigned i = 0; i < nWorkers; ++i, v = (v + 1) % nWorkers) {
+            if (&workers[v] != w && (ao = workers[v].deque.steal()) != 0) {
+                return ao;
+            }
+        }
+    }
+    return 0;
+}
+
+// check if there is any ready AO (any thread)................................
+bool Sched::hasWork_() const {
+    if (injected.load(std::memory_order_relaxed) != 0) {
+        return true;
+    }
+    for (unsigned i = 0; i < nWorkers; ++i) {
+        if (!workers[i].deque.isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the worker thread routine..................................................
+void Sched::run_(Worker *w) {
+    l_sched = this;
+    l_worker = w;
+    unsigned idle = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        Active *ao = find_(w);
+        if (ao != 0) {
+            idle = 0;
+            if (ao->dispatch_(MAX_AO_BATCH)) { // still has events?
+                ready(ao); // behind the AOs that are ready already
+            }
+        }
+        else if (++idle < MAX_IDLE_SPIN) {
+            std::this_thread::yield();
+        }
+        else { // go to sleep
+            std::unique_lock<std::mutex> lock(mutex);
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (running.load() && !hasWork_()) {
+                cond.wait(lock);
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+    l_sched = 0;
+    l_worker = 0;
+}
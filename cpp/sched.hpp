@@ -0,0 +1,82 @@
+//
+// sched.hpp -- Work-stealing scheduler of active objects
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef SCHED_HPP_
+#define SCHED_HPP_
+
+#include "active.hpp"
+
+// Sched dispatches many active objects on a fixed pool of worker threads.
+// An AO with events is "ready" and sits in exactly one place: the deque of
+// a worker or the list of ready AOs posted from outside of the workers.
+// Only the worker that takes the AO from there dispatches it, so every AO
+// keeps the run-to-completion semantics. Idle workers steal ready AOs
+// from the other deques.
+// The deques are first-in first-out: the owner takes the oldest ready AO
+// like the thieves do, so an AO posting events to other AOs of the same
+// worker cannot starve the AOs made ready before.
+class Sched {
+public:
+    Sched(unsigned nWorkers, unsigned maxActive); // ctor
+    ~Sched();
+    void start();             // start the worker threads
+    void stop();              // stop and join the worker threads
+    void ready(Active *ao);   // called by Active::post()
+private:
+    class Deque { // Chase-Lev deque of a fixed capacity, taken from the top
+    public:
+        void init(unsigned len); // len must be a power of 2
+        ~Deque();
+        void push(Active *ao);   // owner only
+        Active *steal();         // any thread, returns 0 if empty or lost
+        bool isEmpty() const;    // any thread, a snapshot only
+    private:
+        std::atomic<Active *> *buf;
+        long mask;
+        alignas(64) std::atomic<long> top;    // all take from the top
+        alignas(64) std::atomic<long> bottom; // the owner pushes at the bottom
+    };
+    struct Worker {
+        Deque deque;
+        unsigned victim;      // pseudo-random state for picking victims
+        std::thread thread;
+    };
+    void run_(Worker *w);
+    Active *find_(Worker *w); // find a ready AO for the worker
+    bool hasWork_() const;
+
+    Worker *workers;
+    unsigned nWorkers;
+    std::atomic<Active *> injected; // ready AOs posted from other threads
+    std::atomic<unsigned> sleepers; // # of idle workers waiting on cond
+    std::atomic<bool> running;
+    std::mutex mutex;               // protects only the idle workers
+    std::condition_variable cond;
+};
+
+#endif // SCHED_HPP_
@@ -0,0 +1,149 @@
+//
+// schedbench.cpp -- Work-stealing scheduler benchmark
+// Many HsmTest state machines wrapped in active objects pass events
+// ("tokens") to each other. Every AO forwards the token it has processed
+// to another AO, until it has forwarded its quota of tokens. The benchmark
+// measures the event throughput for a growing number of worker threads.
+//
+// Build:
+// g++ -O2 -DHSMTST_QUIET -DHSMTST_NO_MAIN schedbench.cpp sched.cpp
+//     active.cpp evtpool.cpp hsmtst.cpp hsm.cpp -o schedbench -pthread
+//
+#include "sched.hpp"
+#include "hsmtst.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#define QUEUE_LEN 16        // event queue length of every AO
+#define TOKENS    4         // initial # of tokens per AO
+
+static std::atomic<unsigned long> l_alive; // # of tokens in flight
+
+class HsmTestAo : public Active { // HsmTest dispatched as an active object
+    HsmTest sm;
+    HsmTestAo *peers;       // all AOs of the benchmark
+    unsigned nPeers;
+    unsigned rnd;           // pseudo-random state for picking peers
+    unsigned long quota;    // # of tokens still to forward
+public:
+    unsigned long nEvt;     // # of events processed
+    HsmTestAo();
+    void init(HsmTestAo *peers, unsigned nPeers, unsigned self,
+              unsigned long quota);
+    Msg const *topHndlr(Msg const *msg);
+};
+
+HsmTestAo::HsmTestAo()
+  : Active("HsmTestAo", static_cast<EvtHndlr>(&HsmTestAo::topHndlr)),
+    peers(0), nPeers(0), rnd(0), quota(0), nEvt(0)
+{
+    for (Event sig = A_SIG; sig <= H_SIG; ++sig) { // for HSM_SIG_TABLES
+        STATE_HANDLES(&top, sig);
+    }
+}
+
+void HsmTestAo::init(HsmTestAo *p, unsigned n, unsigned s, unsigned long q) {
+    peers = p;
+    nPeers = n;
+    rnd = s;
+    quota = q;
+}
+
+Msg const *HsmTestAo::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        sm.onStart();
+        return 0;
+    case ENTRY_EVT:
+    case EXIT_EVT:
+        return 0;
+    }
+    sm.onEvent(msg);
+    ++nEvt;
+    if (quota != 0) { // forward the next signal to another AO
+        --quota;
+        Msg const *next = &HsmTestMsg[(msg->evt + 1) % (H_SIG + 1)];
+        rnd = rnd * 1103515245U + 12345U;
+        unsigned p = (rnd >> 8) % nPeers;
+        while (!peers[p].post(next)) { // queue full?
+            p = (p + 1) % nPeers;      // total capacity exceeds the tokens
+        }
+    }
+    else {
+        l_alive.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+// run the benchmark with the given # of workers, returns the time in [s]....
+static double run(unsigned nWorkers, unsigned nAo, unsigned long quota,
+                  unsigned long *nEvt)
+{
+    HsmTestAo *ao = new HsmTestAo[nAo];
+    EvtQueue::Cell *qSto = new EvtQueue::Cell[nAo * QUEUE_LEN];
+    Sched sched(nWorkers, nAo);
+    l_alive.store((unsigned long)nAo * TOKENS);
+    for (unsigned i = 0; i < nAo; ++i) {
+        ao[i].init(ao, nAo, i, quota);
+        ao[i].start(&qSto[i * QUEUE_LEN], QUEUE_LEN, &sched);
+    }
+    for (unsigned i = 0; i < nAo; ++i) {
+        for (unsigned k = 0; k < TOKENS; ++k) {
+            ao[i].post(&HsmTestMsg[(i + k) % (H_SIG + 1)]);
+        }
+    }
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    sched.start();
+    while (l_alive.load(std::memory_order_relaxed) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::chrono::steady_clock::time_point t1 =
+        std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < nAo; ++i) {
+        ao[i].stop(); // the last workers may still be leaving the AOs
+    }
+    sched.stop();
+    *nEvt = 0;
+    for (unsigned i = 0; i < nAo; ++i) {
+        *nEvt += ao[i].nEvt;
+    }
+    delete[] qSto;
+    delete[] ao;
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main(int argc, char *argv[]) {
+    unsigned nAo = (argc > 1) ? (unsigned)atoi(argv[1]) : 10000;
+    unsigned long quota = (argc > 2) ? (unsigned long)atol(argv[2]) : 200;
+    unsigned maxWorkers = std::thread::hardware_concurrency();
+    if (argc > 3) {
+        maxWorkers = (unsigned)atoi(argv[3]);
+    }
+    if (maxWorkers == 0) {
+        maxWorkers = 1;
+    }
+    printf("%u HsmTest AOs, %lu tokens forwarded per AO\n\n", nAo, quota);
+    printf("workers     events    time[s]   Mevt/s  speedup\n");
+    double base = 0.0;
+    for (unsigned n = 1; ; n *= 2) { // 1, 2, 4, ... maxWorkers
+        if (n > maxWorkers) {
+            n = maxWorkers;
+        }
+        unsigned long nEvt;
+        double t = run(n, nAo, quota, &nEvt);
+        double rate = nEvt / t;
+        if (n == 1) {
+            base = rate;
+        }
+        printf("%7u %10lu %10.3f %8.2f %8.2f\n",
+               n, nEvt, t, rate / 1e6, rate / base);
+        if (n == maxWorkers) {
+            break;
+        }
+    }
+    return 0;
+}
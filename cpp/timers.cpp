@@ -0,0 +1,233 @@
+//
+// Microwave oven active object driven by time events of a TimeWheel. The
+// cooking time and the lamp blinking while cooking are time events armed
+// for the heating state, so opening the door disarms them on the exit.
+// The alarm of the open door is disarmed explicitly and the sleep timer
+// of the idle oven cascades through the levels of the wheel.
+//
+// Build:
+// g++ timers.cpp timewheel.cpp active.cpp evtpool.cpp sched.cpp hsm.cpp
+//     -o timers -pthread
+//
+#include "timewheel.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+
+#define QUEUE_LEN   64      // event queue length of the oven
+#define COOK_TICKS  300     // cooking time
+#define LAMP_TICKS  7       // lamp blinking period while cooking
+#define ALARM_TICKS 500     // door left open for too long
+#define SLEEP_TICKS 70000   // idle oven goes to sleep (level 2 of the wheel)
+#define SYNC_TICKS  8       // ticks between syncs, fewer expirations than
+                            // QUEUE_LEN in between
+
+enum OvenEvents {
+    Oven_COOK_EVT,
+    Oven_OPEN_EVT,
+    Oven_CLOSE_EVT,
+    Oven_DONE_EVT,          // time events
+    Oven_LAMP_EVT,
+    Oven_ALARM_EVT,
+    Oven_SLEEP_EVT,
+    Oven_SYNC_EVT,          // all the events posted before are dispatched
+    Oven_BUSY_EVT           // long step, the events wait in the queue
+};
+
+class Oven : public Active {
+protected:
+    State idle, heating, paused;
+private:
+    TimeEvt done, lamp, alarm, sleep;
+public:
+    unsigned nCooked, nLamps, nAlarms, nSleeps;
+    unsigned nStray;        // time events not disarmed on time
+    std::atomic<unsigned> nSyncs;
+    std::atomic<bool> busy;
+    Oven(TimeWheel *wheel);
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *idleHndlr(Msg const *msg);
+    Msg const *heatingHndlr(Msg const *msg);
+    Msg const *pausedHndlr(Msg const *msg);
+};
+
+Msg const *Oven::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        STATE_START(&idle);
+        return 0;
+    case Oven_SYNC_EVT:
+        nSyncs.fetch_add(1);
+        return 0;
+    case Oven_BUSY_EVT:
+        while (busy.load()) {
+        }
+        return 0;
+    case Oven_DONE_EVT:
+    case Oven_LAMP_EVT:
+    case Oven_ALARM_EVT:
+    case Oven_SLEEP_EVT:
+        ++nStray;
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Oven::idleHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        sleep.arm(SLEEP_TICKS, 0, &idle);
+        return 0;
+    case Oven_COOK_EVT:
+        STATE_TRAN(&heating);
+        return 0;
+    case Oven_SLEEP_EVT:
+        ++nSleeps;
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Oven::heatingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        done.arm(COOK_TICKS, 0, &heating);
+        lamp.arm(LAMP_TICKS, LAMP_TICKS, &heating);
+        return 0;
+    case Oven_DONE_EVT:
+        ++nCooked;
+        STATE_TRAN(&idle);
+        return 0;
+    case Oven_LAMP_EVT:
+        ++nLamps;
+        return 0;
+    case Oven_OPEN_EVT:
+        STATE_TRAN(&paused);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Oven::pausedHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        alarm.arm(ALARM_TICKS, 0, 0);
+        return 0;
+    case EXIT_EVT:
+        alarm.disarm();
+        return 0;
+    case Oven_CLOSE_EVT:
+        STATE_TRAN(&heating); // cook again from the start
+        return 0;
+    case Oven_ALARM_EVT:
+        ++nAlarms;
+        STATE_TRAN(&idle);
+        return 0;
+    }
+    return msg;
+}
+
+Oven::Oven(TimeWheel *wheel)
+  : Active("Oven",                 static_cast<EvtHndlr>(&Oven::topHndlr)),
+    idle("idle",       &top,      static_cast<EvtHndlr>(&Oven::idleHndlr)),
+    heating("heating", &top,      static_cast<EvtHndlr>(&Oven::heatingHndlr)),
+    paused("paused",   &top,      static_cast<EvtHndlr>(&Oven::pausedHndlr)),
+    done(this, Oven_DONE_EVT, wheel), lamp(this, Oven_LAMP_EVT, wheel),
+    alarm(this, Oven_ALARM_EVT, wheel), sleep(this, Oven_SLEEP_EVT, wheel),
+    nCooked(0), nLamps(0), nAlarms(0), nSleeps(0), nStray(0), nSyncs(0),
+    busy(false)
+{
+    STATE_HANDLES(&top, Oven_SYNC_EVT); // for HSM_SIG_TABLES
+    STATE_HANDLES(&top, Oven_BUSY_EVT);
+    STATE_HANDLES(&top, Oven_DONE_EVT);
+    STATE_HANDLES(&top, Oven_LAMP_EVT);
+    STATE_HANDLES(&top, Oven_ALARM_EVT);
+    STATE_HANDLES(&top, Oven_SLEEP_EVT);
+    STATE_HANDLES(&idle, Oven_COOK_EVT);
+    STATE_HANDLES(&idle, Oven_SLEEP_EVT);
+    STATE_HANDLES(&heating, Oven_DONE_EVT);
+    STATE_HANDLES(&heating, Oven_LAMP_EVT);
+    STATE_HANDLES(&heating, Oven_OPEN_EVT);
+    STATE_HANDLES(&paused, Oven_CLOSE_EVT);
+    STATE_HANDLES(&paused, Oven_ALARM_EVT);
+}
+
+const Msg ovenMsg[] = {
+    { Oven_COOK_EVT  },
+    { Oven_OPEN_EVT  },
+    { Oven_CLOSE_EVT },
+    { Oven_DONE_EVT  },
+    { Oven_LAMP_EVT  },
+    { Oven_ALARM_EVT },
+    { Oven_SLEEP_EVT },
+    { Oven_SYNC_EVT  },
+    { Oven_BUSY_EVT  }
+};
+
+static void post(Oven *o, Event evt) {
+    while (!o->post(&ovenMsg[evt])) { // queue full?
+    }
+}
+
+// wait until the oven dispatched all the events posted before..............
+static void sync(Oven *o) {
+    unsigned n = o->nSyncs.load();
+    post(o, Oven_SYNC_EVT);
+    while (o->nSyncs.load() == n) {
+    }
+}
+
+// tick after the events posted before and wait for the expirations.........
+static void tick(TimeWheel *wheel, Oven *o, unsigned ticks) {
+    sync(o);
+    for (unsigned k = 1; k <= ticks; ++k) {
+        wheel->tick();
+        if (k % SYNC_TICKS == 0) {
+            sync(o); // the queue drained before the next expirations
+        }
+    }
+    sync(o);
+}
+
+int main() {
+    static EvtQueue::Cell qSto[QUEUE_LEN];
+    TimeWheel wheel;
+    Oven oven(&wheel);
+    oven.start(qSto, QUEUE_LEN);
+
+    post(&oven, Oven_COOK_EVT);        // the sleep timer is disarmed on exit
+    tick(&wheel, &oven, COOK_TICKS);
+    assert(oven.nCooked == 1 && oven.nLamps == COOK_TICKS / LAMP_TICKS);
+
+    post(&oven, Oven_COOK_EVT);
+    tick(&wheel, &oven, 100);
+    post(&oven, Oven_OPEN_EVT);        // cooking and the lamp disarmed
+    tick(&wheel, &oven, 50);
+    post(&oven, Oven_CLOSE_EVT);       // the alarm disarmed
+    tick(&wheel, &oven, ALARM_TICKS + COOK_TICKS);
+    assert(oven.nCooked == 2 && oven.nAlarms == 0);
+    assert(oven.nLamps == (COOK_TICKS / LAMP_TICKS) * 2 + 100 / LAMP_TICKS);
+    unsigned nLamps = oven.nLamps;
+
+    post(&oven, Oven_COOK_EVT);
+    sync(&oven);
+    oven.busy.store(true);
+    post(&oven, Oven_BUSY_EVT);
+    post(&oven, Oven_OPEN_EVT);        // opened before the cooking is done...
+    for (unsigned k = 0; k < COOK_TICKS; ++k) { // ...and seen only after it
+        wheel.tick();
+    }
+    oven.busy.store(false);
+    sync(&oven);                       // the queued expirations are dropped
+    assert(oven.nCooked == 2 && oven.nLamps == nLamps);
+    tick(&wheel, &oven, ALARM_TICKS);
+    assert(oven.nAlarms == 1);
+
+    tick(&wheel, &oven, SLEEP_TICKS);  // only the last idle state sleeps
+    oven.stop();
+    printf("%llu ticks: %u cooked, %u lamps, %u alarms, %u sleeps, "
+           "%u stray, %u lost\n", wheel.now(), oven.nCooked, oven.nLamps,
+           oven.nAlarms, oven.nSleeps, oven.nStray, wheel.nLost.load());
+    assert(oven.nSleeps == 1 && oven.nStray == 0 && wheel.nLost.load() == 0);
+    return 0;
+}
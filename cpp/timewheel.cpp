@@ -0,0 +1,157 @@
+//
+// timewheel.cpp -- Time events on a hierarchical timing wheel
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#include <assert.h>
+#include "timewheel.hpp"
+
+// TimeEvt Ctor...............................................................
+TimeEvt::TimeEvt(Active *a, Event e, TimeWheel *w)
+  : ao(a), wheel(w), owner(0), next(0), pprev(0), expiry(0), interval(0),
+    queued(0), stale(0)
+{
+    evt = e;
+    nextOfAo = ao->timeEvts; // the AO recognizes its time events
+    ao->timeEvts = this;
+    assert(ao->exitHook == 0 || ao->exitHook == &TimeEvt::onExit_);
+    ao->exitHook = &TimeEvt::onExit_; // the AO has no other exit hook
+}
+
+// arm the time event (re-arm it if it is armed already)......................
+void TimeEvt::arm(unsigned ticks, unsigned ivl, State *s) {
+    assert(ticks > 0);
+    std::lock_guard<std::mutex> lock(wheel->mutex);
+    if (pprev != 0) {
+        wheel->remove_(this);
+    }
+    owner = s;
+    interval = ivl;
+    expiry = wheel->ticks + ticks;
+    wheel->insert_(this);
+}
+
+// disarm the time event and drop its queued expirations......................
+bool TimeEvt::disarm() {
+    std::lock_guard<std::mutex> lock(wheel->mutex);
+    bool wasArmed = (pprev != 0);
+    if (wasArmed) {
+        wheel->remove_(this);
+    }
+    stale = queued.load(std::memory_order_relaxed); // posted under the mutex
+    return wasArmed;
+}
+
+// disarm the time events armed for the state that has just exited...........
+void TimeEvt::onExit_(Hsm *me, State *s) {
+    for (TimeEvt *te = static_cast<Active *>(me)->timeEvts; te != 0;
+         te = te->nextOfAo)
+    {
+        if (te->owner == s) {
+            te->owner = 0;
+            te->disarm();
+        }
+    }
+}
+
+// TimeWheel Ctor.............................................................
+TimeWheel::TimeWheel()
+  : nLost(0), ticks(0)
+{
+    for (unsigned l = 0; l < WHEEL_LEVELS; ++l) {
+        for (unsigned i = 0; i < WHEEL_SLOTS; ++i) {
+            slot[l][i] = 0;
+        }
+    }
+}
+
+// link the time event in the slot of its expiry..............................
+void TimeWheel::insert_(TimeEvt *te) {
+    unsigned long long delta = te->expiry - ticks; // 0 if expiring now
+    unsigned l = 0;
+    while (l < WHEEL_LEVELS - 1 && delta >= (1ULL << ((l + 1) * WHEEL_BITS))) {
+        ++l; // expires beyond the range of the level
+    }
+    unsigned long long at = te->expiry;
+    if (delta >= (1ULL << (WHEEL_LEVELS * WHEEL_BITS))) { // beyond the wheel?
+        at = ticks + (1ULL << (WHEEL_LEVELS * WHEEL_BITS)) - 1; // wait there
+    }
+    TimeEvt **head = &slot[l][(at >> (l * WHEEL_BITS)) & (WHEEL_SLOTS - 1)];
+    te->next = *head;
+    if (*head != 0) {
+        (*head)->pprev = &te->next;
+    }
+    te->pprev = head;
+    *head = te;
+}
+
+// unlink the time event......................................................
+void TimeWheel::remove_(TimeEvt *te) {
+    *te->pprev = te->next;
+    if (te->next != 0) {
+        te->next->pprev = te->pprev;
+    }
+    te->pprev = 0;
+    te->next = 0;
+}
+
+// advance the wheel by one tick and post the expired time events.............
+void TimeWheel::tick() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++ticks;
+    for (unsigned l = 1; l < WHEEL_LEVELS; ++l) { // cascade the upper levels
+        if ((ticks & ((1ULL << (l * WHEEL_BITS)) - 1)) != 0) {
+            break; // not at the boundary of level l
+        }
+        TimeEvt **head = &slot[l][(ticks >> (l * WHEEL_BITS))
+                                  & (WHEEL_SLOTS - 1)];
+        TimeEvt *te = *head;
+        *head = 0;
+        while (te != 0) {
+            TimeEvt *next = te->next;
+            insert_(te); // in a lower level (or the same if beyond the wheel)
+            te = next;
+        }
+    }
+    TimeEvt **head = &slot[0][ticks & (WHEEL_SLOTS - 1)];
+    TimeEvt *te = *head;
+    *head = 0;
+    while (te != 0) {
+        TimeEvt *next = te->next;
+        te->pprev = 0;
+        te->next = 0;
+        if (te->interval != 0) { // periodic?
+            te->expiry += te->interval;
+            insert_(te);
+        }
+        te->queued.fetch_add(1, std::memory_order_relaxed);
+        if (!te->ao->post(te)) {
+            te->queued.fetch_sub(1, std::memory_order_relaxed);
+            nLost.fetch_add(1, std::memory_order_relaxed);
+        }
+        te = next;
+    }
+}
@@ -0,0 +1,104 @@
+//
+// timewheel.hpp -- Time events on a hierarchical timing wheel
+//
+// Copyright 2000 Miro Samek. All rights reserved.
+//
+// This software is licensed under the following open source MIT license:
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+// Contact information:
+// miro@quantum-leaps.com
+//
+#ifndef TIMEWHEEL_HPP_
+#define TIMEWHEEL_HPP_
+
+#include "active.hpp"
+
+#define WHEEL_LEVELS 4      // # of levels of the timing wheel
+#define WHEEL_BITS   8      // log2 of the # of slots per level
+#define WHEEL_SLOTS  (1U << WHEEL_BITS)
+
+class TimeWheel; // forward declaration
+
+// TimeEvt is an event that its TimeWheel posts to the active object after
+// the armed number of ticks, and then every interval ticks if periodic.
+// A time event armed for a state is disarmed when that state exits. Once
+// disarmed, an expiration still waiting in the event queue is dropped, so
+// the active object never receives a time event that is not armed.
+// arm() and disarm() must be called in the thread of the active object.
+class TimeEvt : public Msg {
+public:
+    TimeEvt(Active *ao, Event evt, TimeWheel *wheel); // ctor
+    void arm(unsigned ticks, unsigned interval, State *owner); // owner or 0
+    bool disarm();                // returns true if it was armed
+    bool isArmed() const { return pprev != 0; }
+private:
+    static void onExit_(Hsm *me, State *s); // Hsm::exitHook of the AO
+    static bool isStale_(Active *ao, Msg const *msg);
+    Active *ao;                   // recipient of the time event
+    TimeWheel *wheel;
+    State *owner;                 // state disarming it on exit (or 0)
+    TimeEvt *next;                // next in the slot of the wheel
+    TimeEvt **pprev;              // link pointing to it (0 if disarmed)
+    TimeEvt *nextOfAo;            // next time event of the same AO
+    unsigned long long expiry;    // tick of the next expiration
+    unsigned interval;            // period in ticks (0 for one-shot)
+    std::atomic<unsigned> queued; // # of expirations in the event queue
+    unsigned stale;               // # of queued expirations to drop
+    friend class TimeWheel;
+    friend class Active;
+};
+
+// TimeWheel keeps the armed time events in WHEEL_LEVELS levels of slots.
+// A level covers WHEEL_SLOTS times the range of the level below it, so
+// arming, disarming and ticking take constant time regardless of the
+// number of armed time events. A time event waits in a higher level until
+// its slot is cascaded to the levels below.
+class TimeWheel {
+public:
+    TimeWheel(); // ctor
+    void tick();                  // any thread, the time base of the wheel
+    unsigned long long now() const { return ticks; }
+    std::atomic<unsigned> nLost;  // # of expirations lost to full queues
+private:
+    void insert_(TimeEvt *te);    // the mutex must be held
+    void remove_(TimeEvt *te);    // the mutex must be held
+    TimeEvt *slot[WHEEL_LEVELS][WHEEL_SLOTS];
+    unsigned long long ticks;     // # of ticks since the start
+    std::mutex mutex;
+    friend class TimeEvt;
+};
+
+// check if the event is an expiration of a disarmed time event...............
+inline bool TimeEvt::isStale_(Active *ao, Msg const *msg) {
+    for (TimeEvt *te = ao->timeEvts; te != 0; te = te->nextOfAo) {
+        if (te == msg) {
+            te->queued.fetch_sub(1, std::memory_order_relaxed);
+            if (te->stale != 0) {
+                --te->stale;
+                return true;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+#endif // TIMEWHEEL_HPP_
@@ -0,0 +1,198 @@
+//
+// tracedec.cpp -- Decoder of the binary traces saved by traceDump()
+// Prints the records in the style of the HsmTest output, for example
+// "top-ENTRY;top-INIT;s1-ENTRY;s1-INIT;s11-ENTRY;", or one record per
+// line with the time stamp, thread and machine (-v). The names of the
+// signals 0, 1, 2, ... can be given as a comma-separated list.
+//
+// Build:
+// g++ tracedec.cpp -o tracedec
+//
+// usage: tracedec [-v] trace-file [signal-names]
+//
+#include "hsmtrace.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+struct Str {                  // one name of the trace
+    unsigned long long ptr;   // the name pointer in the traced program
+    char *str;
+};
+
+static Str *l_str;            // names sorted by ptr
+static unsigned l_nStr;
+static char const *l_sig[256]; // signal names (or 0)
+
+struct HsmName {              // name of one traced machine
+    unsigned id;
+    char const *name;
+};
+
+static HsmName *l_hsm;        // machine names sorted by id
+static unsigned l_nHsm;
+
+// find the name the traced program had at the pointer ptr....................
+static char const *nameOf_(char const *ptr) {
+    unsigned long long p = (unsigned long long)(size_t)ptr;
+    unsigned lo = 0;
+    unsigned hi = l_nStr;
+    while (lo < hi) { // binary search
+        unsigned mid = (lo + hi) / 2;
+        if (l_str[mid].ptr < p) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return (lo < l_nStr && l_str[lo].ptr == p) ? l_str[lo].str : "?";
+}
+
+// find the name of the machine with the given id...........................
+static char const *hsmOf_(unsigned id) {
+    unsigned lo = 0;
+    unsigned hi = l_nHsm;
+    while (lo < hi) { // binary search
+        unsigned mid = (lo + hi) / 2;
+        if (l_hsm[mid].id < id) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return (lo < l_nHsm && l_hsm[lo].id == id) ? l_hsm[lo].name : "?";
+}
+
+static bool byId_(HsmName const &a, HsmName const &b) {
+    return a.id < b.id;
+}
+
+static void printEvt_(Event evt) {
+    if (0 <= evt && evt < 256 && l_sig[evt] != 0) {
+        printf("%s", l_sig[evt]);
+    }
+    else {
+        printf("%d", evt);
+    }
+}
+
+// print one record in the style of the HsmTest output........................
+static void print_(TraceRec const *r) {
+    switch (r->kind) {
+    case TRACE_DISPATCH:
+    case TRACE_TRAN:
+        printf("%s-", nameOf_(r->name));
+        printEvt_(r->evt);
+        printf(";");
+        break;
+    case TRACE_ENTRY:
+        printf("%s-ENTRY;", nameOf_(r->name));
+        break;
+    case TRACE_EXIT:
+        printf("%s-EXIT;", nameOf_(r->name));
+        break;
+    case TRACE_INIT:
+        printf("%s-INIT;", nameOf_(r->name));
+        break;
+    }
+}
+
+// print one record per line..................................................
+static void printVerbose_(TraceRec const *r, unsigned long long t0) {
+    static char const * const kind[] = {
+        "HSM", "DISPATCH", "TRAN", "ENTRY", "EXIT", "INIT"
+    };
+    printf("%12llu %3u %-12s %-8s ",
+           r->time - t0, (unsigned)r->thread,
+           hsmOf_(r->hsm),
+           r->kind < sizeof(kind)/sizeof(kind[0]) ? kind[r->kind] : "?");
+    if (r->kind == TRACE_HSM) {
+        printf("#%u\n", (unsigned)r->hsm);
+    }
+    else {
+        printf("%-12s ", nameOf_(r->name));
+        printEvt_(r->evt);
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+    if (verbose) {
+        --argc;
+        ++argv;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: tracedec [-v] trace-file [signal-names]\n");
+        return 2;
+    }
+    if (argc > 2) { // signal names
+        unsigned n = 0;
+        for (char *s = strtok(argv[2], ","); s != 0 && n < 256;
+             s = strtok(0, ","))
+        {
+            l_sig[n++] = s;
+        }
+    }
+    FILE *f = fopen(argv[1], "rb");
+    if (f == 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    TraceFileHdr hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1
+        || memcmp(hdr.magic, "HSMTRAC2", sizeof(hdr.magic)) != 0)
+    {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return 1;
+    }
+    l_str = new Str[hdr.nStr + 1];
+    for (l_nStr = 0; l_nStr < hdr.nStr; ++l_nStr) {
+        Str *s = &l_str[l_nStr];
+        unsigned short len;
+        if (fread(&s->ptr, sizeof(s->ptr), 1, f) != 1
+            || fread(&len, sizeof(len), 1, f) != 1)
+        {
+            break;
+        }
+        s->str = new char[len + 1];
+        if (fread(s->str, 1, len, f) != len) {
+            break;
+        }
+        s->str[len] = '\0';
+    }
+    TraceRec *rec = new TraceRec[hdr.nRec + 1];
+    if (l_nStr != hdr.nStr
+        || fread(rec, sizeof(TraceRec), hdr.nRec, f) != hdr.nRec)
+    {
+        fprintf(stderr, "%s: truncated trace file\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    l_hsm = new HsmName[hdr.nRec + 1];
+    for (unsigned i = 0; i < hdr.nRec; ++i) { // the machines in the trace
+        if (rec[i].kind == TRACE_HSM) {
+            l_hsm[l_nHsm].id = rec[i].hsm;
+            l_hsm[l_nHsm].name = nameOf_(rec[i].name);
+            ++l_nHsm;
+        }
+    }
+    std::sort(l_hsm, l_hsm + l_nHsm, byId_);
+    for (unsigned i = 0; i < hdr.nRec; ++i) {
+        if (verbose) {
+            printVerbose_(&rec[i], rec[0].time);
+        }
+        else {
+            print_(&rec[i]);
+        }
+    }
+    if (!verbose) {
+        printf("\n");
+    }
+    return 0;
+}
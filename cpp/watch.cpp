@@ -2,56 +2,30 @@
 // Simple digital watch example
 // M. Samek, 01/07/00
 //
-#include "hsm.hpp"
+#include "watch.hpp"
 
 #include <stdio.h>
 #include <assert.h>
 
-class Watch : public Hsm {
-protected:
-    State timekeeping, time, date;
-    State setting, hour, minute, day, month;
-    State *timekeepingHist;
-private:
-    int tsec, tmin, thour, dday, dmonth;
-
-public:
-    Watch();
-    Msg const *topHndlr(Msg const *msg);
-    Msg const *timekeepingHndlr(Msg const *msg);
-    Msg const *timeHndlr(Msg const *msg);
-    Msg const *dateHndlr(Msg const *msg);
-    Msg const *settingHndlr(Msg const *msg);
-    Msg const *hourHndlr(Msg const *msg);
-    Msg const *minuteHndlr(Msg const *msg);
-    Msg const *dayHndlr(Msg const *msg);
-    Msg const *monthHndlr(Msg const *msg);
-    void tick();
-    void showTime();
-    void showDate();
-};
-
-enum WatchEvents {
-    Watch_MODE_EVT,
-    Watch_SET_EVT,
-    Watch_TICK_EVT
-};
-
 // lookup table for the days of a month
 static int const day_of_month_lut[] = {
     0, /* unused month #0 */
     31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
 };
 
+WatchClock::WatchClock()
+  : tsec(0), tmin(0), thour(0), dday(1), dmonth(1)
+{}
+
 void Watch::showTime() {
-    printf("time: %2d:%02d:%02d", thour, tmin, tsec);
+    WATCH_PRINT("time: %2d:%02d:%02d", thour, tmin, tsec);
 }
 
 void Watch::showDate() {
-    printf("date: %02d-%02d", dmonth, dday);
+    WATCH_PRINT("date: %02d-%02d", dmonth, dday);
 }
 
-void Watch::tick() {
+void WatchClock::tick() {
     if (++tsec == 60) {
         tsec = 0;
         if (++tmin == 60) {
@@ -88,11 +62,11 @@ Msg const *Watch::timekeepingHndlr(Msg const *msg) {
         return 0;
     case Watch_SET_EVT:
         STATE_TRAN(&setting);
-        printf("Watch::timekeeping-SET;");
+        WATCH_PRINT("Watch::timekeeping-SET;");
         return 0;
     case Watch_TICK_EVT:
         tick();
-        printf("Watch::timekeeping-TICK;");
+        WATCH_PRINT("Watch::timekeeping-TICK;");
         return 0;
     }
     return msg;
@@ -105,10 +79,10 @@ Msg const *Watch::timeHndlr(Msg const *msg) {
         return 0;
     case Watch_MODE_EVT:
         STATE_TRAN(&date);
-        printf("Watch::time-MODE;");
+        WATCH_PRINT("Watch::time-MODE;");
         return 0;
     case Watch_TICK_EVT:
-        printf("Watch::time-TICK;");
+        WATCH_PRINT("Watch::time-TICK;");
         tick();
         showTime();
         return 0;
@@ -123,10 +97,10 @@ Msg const *Watch::dateHndlr(Msg const *msg) {
         return 0;
     case Watch_MODE_EVT:
         STATE_TRAN(&time);
-        printf("Watch::date-MODE;");
+        WATCH_PRINT("Watch::date-MODE;");
         return 0;
     case Watch_TICK_EVT:
-        printf("Watch::date-TICK;");
+        WATCH_PRINT("Watch::date-TICK;");
         tick();
         showDate();
         return 0;
@@ -138,7 +112,7 @@ Msg const *Watch::settingHndlr(Msg const *msg) {
     switch (msg->evt) {
     case START_EVT:
         STATE_START(&hour);
-        printf("Watch::setting-START->hour;");
+        WATCH_PRINT("Watch::setting-START->hour;");
         return 0;
     }
     return msg;
@@ -154,7 +128,7 @@ Msg const *Watch::hourHndlr(Msg const *msg) {
         return 0;
     case Watch_SET_EVT:
         STATE_TRAN(&minute);
-        printf("Watch::hour-SET;");
+        WATCH_PRINT("Watch::hour-SET;");
         return 0;
     }
     return msg;
@@ -185,7 +159,7 @@ Msg const *Watch::dayHndlr(Msg const *msg) {
         return 0;
     case Watch_SET_EVT:
         STATE_TRAN(&month);
-        printf("Watch::day-SET;");
+        WATCH_PRINT("Watch::day-SET;");
         return 0;
     }
     return msg;
@@ -201,7 +175,7 @@ Msg const *Watch::monthHndlr(Msg const *msg) {
         return 0;
     case Watch_SET_EVT:
         STATE_TRAN(&timekeeping);
-        printf("Watch::month-SET;");
+        WATCH_PRINT("Watch::month-SET;");
         return 0;
     }
     return msg;
@@ -216,18 +190,32 @@ Watch::Watch()
     hour("hour",       &setting,     static_cast<EvtHndlr>(&Watch::hourHndlr)),
     minute("minute",   &setting,     static_cast<EvtHndlr>(&Watch::minuteHndlr)),
     day("day",         &setting,     static_cast<EvtHndlr>(&Watch::dayHndlr)),
-    month("month",     &setting,     static_cast<EvtHndlr>(&Watch::monthHndlr)),
-    tsec(0), tmin(0), thour(0), dday(1), dmonth(1)
+    month("month",     &setting,     static_cast<EvtHndlr>(&Watch::monthHndlr))
 {
     timekeepingHist = &time;
+    STATE_HANDLES(&timekeeping, Watch_SET_EVT); // for HSM_SIG_TABLES
+    STATE_HANDLES(&timekeeping, Watch_TICK_EVT);
+    STATE_HANDLES(&time, Watch_MODE_EVT);
+    STATE_HANDLES(&time, Watch_TICK_EVT);
+    STATE_HANDLES(&date, Watch_MODE_EVT);
+    STATE_HANDLES(&date, Watch_TICK_EVT);
+    STATE_HANDLES(&hour, Watch_MODE_EVT);
+    STATE_HANDLES(&hour, Watch_SET_EVT);
+    STATE_HANDLES(&minute, Watch_MODE_EVT);
+    STATE_HANDLES(&minute, Watch_SET_EVT);
+    STATE_HANDLES(&day, Watch_MODE_EVT);
+    STATE_HANDLES(&day, Watch_SET_EVT);
+    STATE_HANDLES(&month, Watch_MODE_EVT);
+    STATE_HANDLES(&month, Watch_SET_EVT);
 }
 
-const Msg watchMsg[] = {
+Msg const watchMsg[] = {
     { Watch_MODE_EVT },
     { Watch_SET_EVT  },
     { Watch_TICK_EVT }
 };
 
+#ifndef WATCH_NO_MAIN
 int main() {
     Watch watch;
 
@@ -250,3 +238,4 @@ int main() {
     }
     return 0;
 }
+#endif // WATCH_NO_MAIN
@@ -0,0 +1,50 @@
+//
+// watch.hpp -- Simple digital watch example
+//
+#ifndef WATCH_HPP_
+#define WATCH_HPP_
+
+#include "hsm.hpp"
+
+struct WatchClock { // time of the watches, ticked once a second
+    int tsec, tmin, thour, dday, dmonth;
+    WatchClock();
+    void tick();
+};
+
+class Watch : public Hsm, public WatchClock {
+protected:
+    State timekeeping, time, date;
+    State setting, hour, minute, day, month;
+    State *timekeepingHist;
+public:
+    Watch();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *timekeepingHndlr(Msg const *msg);
+    Msg const *timeHndlr(Msg const *msg);
+    Msg const *dateHndlr(Msg const *msg);
+    Msg const *settingHndlr(Msg const *msg);
+    Msg const *hourHndlr(Msg const *msg);
+    Msg const *minuteHndlr(Msg const *msg);
+    Msg const *dayHndlr(Msg const *msg);
+    Msg const *monthHndlr(Msg const *msg);
+    void showTime();
+    void showDate();
+};
+
+enum WatchEvents {
+    Watch_MODE_EVT,
+    Watch_SET_EVT,
+    Watch_TICK_EVT,
+    Watch_MAX_EVT           // the events of the other watches start here
+};
+
+extern Msg const watchMsg[];
+
+#ifdef WATCH_QUIET
+#define WATCH_PRINT(...) ((void)0)
+#else
+#define WATCH_PRINT(...) printf(__VA_ARGS__)
+#endif
+
+#endif // WATCH_HPP_
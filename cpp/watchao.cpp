@@ -0,0 +1,114 @@
+//
+// Digital watch of watch.cpp as an active object, which defers the ticks
+// arriving while the time is being set and recalls them afterwards, so
+// the watch does not lose any time.
+//
+// Build:
+// g++ -DWATCH_NO_MAIN watchao.cpp watch.cpp active.cpp evtpool.cpp sched.cpp
+//     hsm.cpp -o watchao -pthread
+//
+#include "active.hpp"
+#include "watch.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+
+#define QUEUE_LEN 16        // event queue length of the watch
+#define DEFER_LEN 8         // max # of ticks deferred while setting
+
+class WatchAo : public Active, public WatchClock {
+protected:
+    State timekeeping, setting;
+private:
+    Msg const *deferSto[DEFER_LEN];
+public:
+    unsigned nLost;         // # of ticks not deferred
+    WatchAo();
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *timekeepingHndlr(Msg const *msg);
+    Msg const *settingHndlr(Msg const *msg);
+};
+
+Msg const *WatchAo::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        STATE_START(&timekeeping);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *WatchAo::timekeepingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_SET_EVT:
+        STATE_TRAN(&setting);
+        return 0;
+    case Watch_TICK_EVT:
+        tick();
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *WatchAo::settingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case EXIT_EVT:
+        while (recall()) { // the deferred ticks after the queued events
+        }
+        return 0;
+    case Watch_MODE_EVT:
+        if (++thour == 24) {
+            thour = 0;
+        }
+        return 0;
+    case Watch_SET_EVT:
+        STATE_TRAN(&timekeeping);
+        return 0;
+    case Watch_TICK_EVT:
+        if (!defer(msg)) {
+            ++nLost;
+        }
+        return 0;
+    }
+    return msg;
+}
+
+WatchAo::WatchAo()
+  : Active("WatchAo",                 static_cast<EvtHndlr>(&WatchAo::topHndlr)),
+    timekeeping("timekeeping", &top, static_cast<EvtHndlr>(&WatchAo::timekeepingHndlr)),
+    setting("setting",         &top, static_cast<EvtHndlr>(&WatchAo::settingHndlr)),
+    nLost(0)
+{
+    deferInit(deferSto, DEFER_LEN);
+    STATE_HANDLES(&timekeeping, Watch_SET_EVT); // for HSM_SIG_TABLES
+    STATE_HANDLES(&timekeeping, Watch_TICK_EVT);
+    STATE_HANDLES(&setting, Watch_MODE_EVT);
+    STATE_HANDLES(&setting, Watch_SET_EVT);
+    STATE_HANDLES(&setting, Watch_TICK_EVT);
+}
+
+static void post(WatchAo *w, Event evt) {
+    while (!w->post(&watchMsg[evt])) { // queue full?
+    }
+}
+
+int main() {
+    static EvtQueue::Cell qSto[QUEUE_LEN];
+    WatchAo watch;
+    watch.start(qSto, QUEUE_LEN);
+    for (unsigned k = 0; k < 3; ++k) {
+        post(&watch, Watch_TICK_EVT);
+    }
+    post(&watch, Watch_SET_EVT);       // setting the hour...
+    for (unsigned k = 0; k < 5; ++k) {
+        post(&watch, Watch_TICK_EVT);  // ...while the time goes on
+    }
+    post(&watch, Watch_MODE_EVT);
+    post(&watch, Watch_SET_EVT);       // back to timekeeping
+    post(&watch, Watch_TICK_EVT);
+    watch.stop();
+    printf("time: %2d:%02d:%02d, %u ticks lost\n",
+           watch.thour, watch.tmin, watch.tsec, watch.nLost);
+    assert(watch.thour == 1 && watch.tsec == 9 && watch.nLost == 0);
+    return 0;
+}
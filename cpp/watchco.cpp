@@ -0,0 +1,129 @@
+//
+// Digital watch of watch.cpp as an active object, which synchronizes its
+// time with a slow time server in a coroutine action. The watch goes on
+// ticking while it waits, and the time arrives as an event.
+//
+// Build (C++20):
+// g++ -std=c++20 -DWATCH_NO_MAIN watchco.cpp watch.cpp hsmco.cpp active.cpp
+//     evtpool.cpp sched.cpp hsm.cpp -o watchco -pthread
+//
+#include "hsmco.hpp"
+#include "evtpool.hpp"
+#include "watch.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+
+#define QUEUE_LEN 16        // event queue length of the watch
+
+enum WatchCoEvents {
+    Watch_SYNC_EVT = Watch_MAX_EVT, // synchronize with the time server
+    Watch_SYNCED_EVT        // SyncEvt, the time of the server
+};
+
+struct SyncEvt : public Msg {
+    int hour;
+};
+
+class WatchCo : public Active, public WatchClock {
+protected:
+    State timekeeping, syncing;
+private:
+    AoWorkers *workers;
+public:
+    unsigned nSyncTicks;    // # of ticks while syncing
+    std::atomic<bool> synced;
+    WatchCo(AoWorkers *w);
+    Msg const *topHndlr(Msg const *msg);
+    Msg const *timekeepingHndlr(Msg const *msg);
+    Msg const *syncingHndlr(Msg const *msg);
+    AoTask sync();
+};
+
+// ask the time server, then post its answer to the watch itself.............
+AoTask WatchCo::sync() {
+    co_await AoDelay(this, workers, std::chrono::milliseconds(10)); // settle
+    int hour = co_await aoCall(this, workers, [] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return 12; // the time server is slow
+    });
+    SyncEvt *e = EVT_NEW(SyncEvt, Watch_SYNCED_EVT);
+    assert(e != 0);
+    e->hour = hour;
+    post(e);
+}
+
+Msg const *WatchCo::topHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        STATE_START(&timekeeping);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *WatchCo::timekeepingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_SYNC_EVT:
+        STATE_TRAN(&syncing);
+        return 0;
+    case Watch_TICK_EVT:
+        tick();
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *WatchCo::syncingHndlr(Msg const *msg) {
+    switch (msg->evt) {
+    case ENTRY_EVT:
+        sync(); // returns at its first co_await
+        return 0;
+    case Watch_SYNCED_EVT:
+        thour = static_cast<SyncEvt const *>(msg)->hour;
+        synced.store(true);
+        STATE_TRAN(&timekeeping);
+        return 0;
+    case Watch_TICK_EVT:
+        ++nSyncTicks;
+        return msg; // the time goes on
+    }
+    return msg;
+}
+
+WatchCo::WatchCo(AoWorkers *w)
+  : Active("WatchCo",                 static_cast<EvtHndlr>(&WatchCo::topHndlr)),
+    timekeeping("timekeeping", &top, static_cast<EvtHndlr>(&WatchCo::timekeepingHndlr)),
+    syncing("syncing", &timekeeping, static_cast<EvtHndlr>(&WatchCo::syncingHndlr)),
+    workers(w), nSyncTicks(0), synced(false)
+{
+    STATE_HANDLES(&timekeeping, Watch_SYNC_EVT); // for HSM_SIG_TABLES
+    STATE_HANDLES(&timekeeping, Watch_TICK_EVT);
+    STATE_HANDLES(&syncing, Watch_SYNCED_EVT);
+    STATE_HANDLES(&syncing, Watch_TICK_EVT);
+}
+
+static Msg const syncMsg = { Watch_SYNC_EVT };
+
+int main() {
+    static EvtQueue::Cell qSto[QUEUE_LEN];
+    static char poolSto[4 * 64];
+    evtPoolInit(poolSto, sizeof(poolSto), sizeof(SyncEvt));
+    AoWorkers workers(1);
+    WatchCo watch(&workers);
+    watch.start(qSto, QUEUE_LEN);
+    watch.post(&syncMsg);
+    unsigned nTicks = 0;
+    while (!watch.synced.load()) { // a tick every ms while syncing
+        while (!watch.post(&watchMsg[Watch_TICK_EVT])) {
+        }
+        ++nTicks;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    watch.stop();
+    printf("time: %2d:%02d:%02d, %u ticks while syncing\n",
+           watch.thour, watch.tmin, watch.tsec, watch.nSyncTicks);
+    assert(watch.thour == 12 && watch.nSyncTicks > 0);
+    assert(watch.tmin * 60 + watch.tsec == (int)nTicks);
+    return 0;
+}
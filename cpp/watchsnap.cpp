@@ -0,0 +1,117 @@
+//
+// Snapshot and restore of many watches of watch.cpp (without the output).
+// Every watch gets random events, then all the watches are saved into an
+// image file and restored from it into new watches, which must behave the
+// same as the original ones.
+//
+// Build:
+// g++ -O2 -DWATCH_QUIET -DWATCH_NO_MAIN watchsnap.cpp watch.cpp hsmsnap.cpp
+//     hsm.cpp -o watchsnap
+//
+// usage: watchsnap [watches [events-per-watch]]
+//
+#include "hsmsnap.hpp"
+#include "watch.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+class WatchSnap : public Watch { // the watch with its snapshot layout
+public:
+    void describe(HsmSnap *snap);
+};
+
+// describe the snapshot of the watches on this prototype.....................
+void WatchSnap::describe(HsmSnap *snap) {
+    snap->state(&timekeeping);
+    snap->state(&time);
+    snap->state(&date);
+    snap->state(&setting);
+    snap->state(&hour);
+    snap->state(&minute);
+    snap->state(&day);
+    snap->state(&month);
+    snap->hist(&timekeepingHist);
+    snap->var(&tsec, sizeof(tsec));
+    snap->var(&tmin, sizeof(tmin));
+    snap->var(&thour, sizeof(thour));
+    snap->var(&dday, sizeof(dday));
+    snap->var(&dmonth, sizeof(dmonth));
+}
+
+// send k random events to every watch........................................
+static void run(WatchSnap *w, unsigned n, unsigned k, unsigned *rnd) {
+    for (unsigned j = 0; j < k; ++j) {
+        for (unsigned i = 0; i < n; ++i) {
+            *rnd = *rnd * 1103515245U + 12345U;
+            w[i].onEvent(&watchMsg[(*rnd >> 16) % 3]);
+        }
+    }
+}
+
+// check that the watches have the same snapshots.............................
+static void check(HsmSnap const *snap, WatchSnap *a, WatchSnap *b,
+                  unsigned n) {
+    unsigned char ra[256], rb[256];
+    assert(snap->recSize() <= sizeof(ra));
+    for (unsigned i = 0; i < n; ++i) {
+        snap->save(&a[i], ra);
+        snap->save(&b[i], rb);
+        assert(memcmp(ra, rb, snap->recSize()) == 0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned n = (argc > 1) ? (unsigned)atoi(argv[1]) : 200000;
+    unsigned k = (argc > 2) ? (unsigned)atoi(argv[2]) : 20;
+    WatchSnap *w = new WatchSnap[n];
+    WatchSnap *copy = new WatchSnap[n];  // restored watches, never started
+    Hsm **pw = new Hsm *[n];
+    Hsm **pcopy = new Hsm *[n];
+    HsmSnap snap(&w[0]);
+    w[0].describe(&snap);
+    unsigned rnd = 1;
+    for (unsigned i = 0; i < n; ++i) {
+        pw[i] = &w[i];
+        pcopy[i] = &copy[i];
+        w[i].onStart();
+    }
+    run(w, n, k, &rnd);
+
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    FILE *f = fopen("watchsnap.img", "wb");
+    bool ok = (f != 0) && snap.saveImage(f, pw, n);
+    ok = (f != 0) && (fclose(f) == 0) && ok;
+    std::chrono::steady_clock::time_point t1 =
+        std::chrono::steady_clock::now();
+    f = fopen("watchsnap.img", "rb");
+    unsigned nRestored = (f != 0) ? snap.restoreFile(f, pcopy, n) : 0;
+    if (f != 0) {
+        fclose(f);
+    }
+    std::chrono::steady_clock::time_point t2 =
+        std::chrono::steady_clock::now();
+    if (!ok || nRestored != n) {
+        printf("watchsnap.img: save or restore failed\n");
+        return 1;
+    }
+
+    check(&snap, w, copy, n);
+    unsigned rnd2 = rnd;      // the same events to both
+    run(w, n, k, &rnd);
+    run(copy, n, k, &rnd2);
+    check(&snap, w, copy, n);
+    printf("%u watches, %u bytes per watch\n", n, snap.recSize());
+    printf("save: %.1f ms, restore: %.1f ms\n",
+           std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           std::chrono::duration<double, std::milli>(t2 - t1).count());
+    delete[] pcopy;
+    delete[] pw;
+    delete[] copy;
+    delete[] w;
+    return 0;
+}
@@ -0,0 +1,377 @@
+//
+// Digital watch example of watch.cpp for many watches at once, on the
+// struct-of-arrays HsmSoA engine. Every watch stores only its current
+// state, its timekeeping history and five bytes of time and date.
+//
+// The TICK_EVT of the watches in time and date is also handled in bulk,
+// with SSE2 or AVX2 instructions (-mavx2) over 16 or 32 watches at once.
+//
+// Build:
+// g++ -O2 watchsoa.cpp hsmsoa.cpp -o watchsoa
+//
+// usage: watchsoa [watches [ticks]]
+//
+#include "hsmsoa.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+enum WatchStates {
+    TOP, TIMEKEEPING, TIME, DATE, SETTING, HOUR, MINUTE, DAY, MONTH,
+    N_WATCH_STATES
+};
+
+enum WatchEvents {
+    Watch_MODE_EVT,
+    Watch_SET_EVT,
+    Watch_TICK_EVT
+};
+
+class Watches : public HsmSoA {
+    StateId *timekeepingHist;
+    unsigned char *tsec, *tmin, *thour, *dday, *dmonth;
+public:
+    static SoAState const stateTbl[N_WATCH_STATES];
+    Watches(unsigned n);
+    ~Watches();
+    Msg const *topHndlr(unsigned i, Msg const *msg);
+    Msg const *timekeepingHndlr(unsigned i, Msg const *msg);
+    Msg const *timeHndlr(unsigned i, Msg const *msg);
+    Msg const *dateHndlr(unsigned i, Msg const *msg);
+    Msg const *settingHndlr(unsigned i, Msg const *msg);
+    Msg const *hourHndlr(unsigned i, Msg const *msg);
+    Msg const *minuteHndlr(unsigned i, Msg const *msg);
+    Msg const *dayHndlr(unsigned i, Msg const *msg);
+    Msg const *monthHndlr(unsigned i, Msg const *msg);
+    void tick(unsigned i);
+    void tickBulk(unsigned char const *sel, unsigned begin, unsigned end);
+    unsigned long secondsOf(unsigned i) const {
+        return (thour[i] * 60UL + tmin[i]) * 60UL + tsec[i];
+    }
+};
+
+// lookup table for the days of a month
+static int const day_of_month_lut[] = {
+    0, /* unused month #0 */
+    31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+void Watches::tick(unsigned i) {
+    if (++tsec[i] == 60) {
+        tsec[i] = 0;
+        if (++tmin[i] == 60) {
+            tmin[i] = 0;
+            if (++thour[i] == 24) {
+                thour[i] = 0;
+                if (++dday[i] > day_of_month_lut[dmonth[i]]) {
+                    dday[i] = 1;
+                    if (++dmonth[i] == 13) {
+                        dmonth[i] = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// tick() of the selected watches, the rare day carry one at a time.........
+void Watches::tickBulk(unsigned char const *sel, unsigned begin,
+                       unsigned end)
+{
+    unsigned i = begin;
+#if defined(__AVX2__)
+    __m256i const sec60 = _mm256_set1_epi8(60);
+    __m256i const hour24 = _mm256_set1_epi8(24);
+    for (; i + 32 <= end; i += 32, sel += 32) {
+        __m256i *s = (__m256i *)&tsec[i];
+        __m256i *m = (__m256i *)&tmin[i];
+        __m256i *h = (__m256i *)&thour[i];
+        // 0xFF for the selected watches, -0xFF adds 1
+        __m256i c = _mm256_sub_epi8(_mm256_setzero_si256(),
+                        _mm256_loadu_si256((__m256i const *)sel));
+        __m256i v = _mm256_sub_epi8(_mm256_loadu_si256(s), c);
+        c = _mm256_cmpeq_epi8(v, sec60);              // seconds carry
+        _mm256_storeu_si256(s, _mm256_andnot_si256(c, v));
+        v = _mm256_sub_epi8(_mm256_loadu_si256(m), c);
+        c = _mm256_cmpeq_epi8(v, sec60);              // minutes carry
+        _mm256_storeu_si256(m, _mm256_andnot_si256(c, v));
+        v = _mm256_sub_epi8(_mm256_loadu_si256(h), c);
+        c = _mm256_cmpeq_epi8(v, hour24);             // hours carry
+        _mm256_storeu_si256(h, _mm256_andnot_si256(c, v));
+        unsigned carry = (unsigned)_mm256_movemask_epi8(c);
+        for (; carry != 0; carry &= carry - 1) {      // next day
+            unsigned k = i + (unsigned)__builtin_ctz(carry);
+            if (++dday[k] > day_of_month_lut[dmonth[k]]) {
+                dday[k] = 1;
+                if (++dmonth[k] == 13) {
+                    dmonth[k] = 1;
+                }
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    __m128i const sec60 = _mm_set1_epi8(60);
+    __m128i const hour24 = _mm_set1_epi8(24);
+    for (; i + 16 <= end; i += 16, sel += 16) {
+        __m128i *s = (__m128i *)&tsec[i];
+        __m128i *m = (__m128i *)&tmin[i];
+        __m128i *h = (__m128i *)&thour[i];
+        // 0xFF for the selected watches, -0xFF adds 1
+        __m128i c = _mm_sub_epi8(_mm_setzero_si128(),
+                        _mm_loadu_si128((__m128i const *)sel));
+        __m128i v = _mm_sub_epi8(_mm_loadu_si128(s), c);
+        c = _mm_cmpeq_epi8(v, sec60);                 // seconds carry
+        _mm_storeu_si128(s, _mm_andnot_si128(c, v));
+        v = _mm_sub_epi8(_mm_loadu_si128(m), c);
+        c = _mm_cmpeq_epi8(v, sec60);                 // minutes carry
+        _mm_storeu_si128(m, _mm_andnot_si128(c, v));
+        v = _mm_sub_epi8(_mm_loadu_si128(h), c);
+        c = _mm_cmpeq_epi8(v, hour24);                // hours carry
+        _mm_storeu_si128(h, _mm_andnot_si128(c, v));
+        unsigned carry = (unsigned)_mm_movemask_epi8(c);
+        for (; carry != 0; carry &= carry - 1) {      // next day
+            unsigned k = i + (unsigned)__builtin_ctz(carry);
+            if (++dday[k] > day_of_month_lut[dmonth[k]]) {
+                dday[k] = 1;
+                if (++dmonth[k] == 13) {
+                    dmonth[k] = 1;
+                }
+            }
+        }
+    }
+#endif
+    for (; i < end; ++i, ++sel) { // scalar fallback and the remainder
+        if (*sel != 0) {
+            tick(i);
+        }
+    }
+}
+
+Msg const *Watches::topHndlr(unsigned, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        stateStart(SETTING);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::timekeepingHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        stateStart(timekeepingHist[i]);
+        return 0;
+    case EXIT_EVT:
+        timekeepingHist[i] = STATE_CURR();
+        return 0;
+    case Watch_SET_EVT:
+        stateTran(SETTING);
+        return 0;
+    case Watch_TICK_EVT:
+        tick(i);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::timeHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_MODE_EVT:
+        stateTran(DATE);
+        return 0;
+    case Watch_TICK_EVT:
+        tick(i);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::dateHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_MODE_EVT:
+        stateTran(TIME);
+        return 0;
+    case Watch_TICK_EVT:
+        tick(i);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::settingHndlr(unsigned, Msg const *msg) {
+    switch (msg->evt) {
+    case START_EVT:
+        stateStart(HOUR);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::hourHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_MODE_EVT:
+        if (++thour[i] == 60) {
+            thour[i] = 0;
+        }
+        return 0;
+    case Watch_SET_EVT:
+        stateTran(MINUTE);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::minuteHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_MODE_EVT:
+        if (++tmin[i] == 60) {
+            tmin[i] = 0;
+        }
+        return 0;
+    case Watch_SET_EVT:
+        stateTran(DAY);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::dayHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_MODE_EVT:
+        if (++dday[i] > day_of_month_lut[dmonth[i]]) {
+            dday[i] = 1;
+        }
+        return 0;
+    case Watch_SET_EVT:
+        stateTran(MONTH);
+        return 0;
+    }
+    return msg;
+}
+
+Msg const *Watches::monthHndlr(unsigned i, Msg const *msg) {
+    switch (msg->evt) {
+    case Watch_MODE_EVT:
+        if (++dmonth[i] > 12 ) {
+            dmonth[i] = 1;
+        }
+        return 0;
+    case Watch_SET_EVT:
+        stateTran(TIMEKEEPING);
+        return 0;
+    }
+    return msg;
+}
+
+SoAState const Watches::stateTbl[N_WATCH_STATES] = {
+    { "top",         SOA_NONE,    static_cast<SoAHndlr>(&Watches::topHndlr) },
+    { "timekeeping", TOP,         static_cast<SoAHndlr>(&Watches::timekeepingHndlr) },
+    { "time",        TIMEKEEPING, static_cast<SoAHndlr>(&Watches::timeHndlr) },
+    { "date",        TIMEKEEPING, static_cast<SoAHndlr>(&Watches::dateHndlr) },
+    { "setting",     TOP,         static_cast<SoAHndlr>(&Watches::settingHndlr) },
+    { "hour",        SETTING,     static_cast<SoAHndlr>(&Watches::hourHndlr) },
+    { "minute",      SETTING,     static_cast<SoAHndlr>(&Watches::minuteHndlr) },
+    { "day",         SETTING,     static_cast<SoAHndlr>(&Watches::dayHndlr) },
+    { "month",       SETTING,     static_cast<SoAHndlr>(&Watches::monthHndlr) }
+};
+
+// TICK_EVT is handled the same way in time and date (and timekeeping)
+static SoABulk const bulkTbl[] = {
+    { Watch_TICK_EVT, (1ULL << TIME) | (1ULL << DATE),
+      static_cast<SoABulkAction>(&Watches::tickBulk) }
+};
+
+Watches::Watches(unsigned n)
+  : HsmSoA(stateTbl, N_WATCH_STATES, n),
+    timekeepingHist(new StateId[n]),
+    tsec(new unsigned char[n]), tmin(new unsigned char[n]),
+    thour(new unsigned char[n]), dday(new unsigned char[n]),
+    dmonth(new unsigned char[n])
+{
+    for (unsigned i = 0; i < n; ++i) {
+        timekeepingHist[i] = TIME;
+        tsec[i] = 0;
+        tmin[i] = 0;
+        thour[i] = 0;
+        dday[i] = 1;
+        dmonth[i] = 1;
+    }
+    setBulk(bulkTbl, sizeof(bulkTbl) / sizeof(bulkTbl[0]));
+}
+
+Watches::~Watches() {
+    delete[] dmonth;
+    delete[] dday;
+    delete[] thour;
+    delete[] tmin;
+    delete[] tsec;
+    delete[] timekeepingHist;
+}
+
+const Msg watchMsg[] = {
+    { Watch_MODE_EVT },
+    { Watch_SET_EVT  },
+    { Watch_TICK_EVT }
+};
+
+int main(int argc, char *argv[]) {
+    unsigned n = (argc > 1) ? (unsigned)atoi(argv[1]) : 1000000;
+    unsigned ticks = (argc > 2) ? (unsigned)atoi(argv[2]) : 100;
+    Watches *w = new Watches(n);
+
+    w->onStartAll(); // setting the hour
+    for (unsigned i = 0; i < n; i += 2) {
+        w->onEvent(i, &watchMsg[Watch_MODE_EVT]); // every 2nd watch 1 AM
+    }
+    for (unsigned k = 0; k < 4; ++k) { // set the minute, day, month
+        w->onEventAll(&watchMsg[Watch_SET_EVT]);
+    }
+    for (unsigned i = 1; i < n; i += 2) {
+        w->onEvent(i, &watchMsg[Watch_MODE_EVT]); // odd watches show date
+    }
+    for (unsigned i = 15; i < n; i += 16) {
+        w->onEvent(i, &watchMsg[Watch_SET_EVT]);  // some set the time again
+    }
+
+    std::chrono::steady_clock::time_point t0 =
+        std::chrono::steady_clock::now();
+    for (unsigned k = 0; k < ticks; ++k) {
+        w->onEventAll(&watchMsg[Watch_TICK_EVT]);
+    }
+    std::chrono::steady_clock::time_point t1 =
+        std::chrono::steady_clock::now();
+    for (unsigned k = 0; k < ticks; ++k) {
+        w->onEventBulk(&watchMsg[Watch_TICK_EVT]);
+    }
+    std::chrono::steady_clock::time_point t2 =
+        std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < n; ++i) { // check the states and the times
+        if ((i & 15) == 15) {
+            assert(w->stateOf(i) == HOUR);
+            assert(w->secondsOf(i) == 0);
+        }
+        else {
+            assert(w->stateOf(i) == ((i & 1) ? DATE : TIME));
+            assert(w->secondsOf(i)
+                   == (((i & 1) ? 0 : 3600) + 2UL * ticks) % 86400);
+        }
+    }
+    double per = (double)n * ticks;
+    printf("%u watches, %u ticks: %.2f ns per watch and tick\n",
+           n, ticks,
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / per);
+    printf("grouped by state: %.2f ns per watch and tick\n",
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / per);
+    printf("watch 0 in %s, watch 1 in %s\n",
+           w->nameOf(w->stateOf(0)), w->nameOf(w->stateOf(1)));
+    printf("%u bytes per watch\n",
+           (unsigned)(sizeof(StateId) * 2 + sizeof(unsigned char) * 5));
+    delete w;
+    return 0;
+}